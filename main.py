@@ -1,29 +1,456 @@
 import argparse
+import os
+import time
 
-from modules import Board, minimax
+from modules import (
+    PLAYOUT_POLICIES,
+    Board,
+    ResidualCache,
+    minimax,
+    minimax_batched,
+    set_residual_cache,
+)
+from modules.census import print_census, run_census
+from modules.estimate import estimate_search, format_seconds
+from modules.evaluation import load_static_weights
+from modules.minimax import (
+    begin_search,
+    set_bipartite_solver,
+    set_search_report,
+    set_transposition_table,
+)
+from modules.parity import BipartiteSolver
+from modules.perft import perft_divide, print_perft, run_perft
+from modules.planner import plan_search
+from modules.play import SolvedStore, play, solve_with_budget
+from modules.profiling import print_hot_summary, profile_call
+from modules.report import SearchReport
+from modules.tds import solve_sharded
+from modules.ttable import (
+    CompactTranspositionTable,
+    GenerationalTranspositionTable,
+    MainTable,
+    SpillingTranspositionTable,
+    TwoLevelTranspositionTable,
+)
+from modules.tuning import load_ordering_weights
+
+# 同梱している残余グラフの勝敗表（頂点数7以下）
+DEFAULT_RESIDUAL_TABLE = os.path.join(
+    os.path.dirname(__file__), "modules", "residual_table.json"
+)
+
+# --tt-spillで--tt-entriesを指定しない場合のメモリの層の登録数の上限
+DEFAULT_SPILL_MEMORY_ENTRIES = 2_000_000
+
+# 同梱している葉の静的評価の重みのプロファイル
+DEFAULT_STATIC_WEIGHTS = os.path.join(
+    os.path.dirname(__file__), "modules", "static_weights.json"
+)
 
 
 def main(args: argparse.Namespace):
-    # チェスボードを初期化する
+    # 移動順序の重みのプロファイルを読み込む
+    ordering_weights = None
+    if args.weights:
+        ordering_weights = load_ordering_weights(
+            args.weights, args.piece_type, (args.height, args.width)
+        )
+
+    board = create_board(args, ordering_weights)
+    if args.plan is not None:
+        # 探索の設定を自動で選び、引数を上書きしてボードを作り直す
+        with board:
+            plan = plan_search(board, args.plan, args.plan_seconds)
+        plan.print()
+        if plan.goal == "length":
+            # ゲームの長さの見積もりが求める出力なので、探索はしない
+            return
+        for name, value in plan.settings.items():
+            setattr(args, name, value)
+        board = create_board(args, ordering_weights)
+    # 例外で終わってもプレイアウトのワーカープロセスを終了する
+    with board:
+        run(board, args)
+
+
+def run(board: Board, args: argparse.Namespace):
+    """引数に従ってボードの探索などを行う
+
+    Args:
+        board (Board): チェスボード
+        args (argparse.Namespace): コマンドライン引数
+    """
+    board.print_board()
+    print(f"状態: {board.encode_state()}")
+
+    if args.split:
+        # 各手の後の状態を、別々に解けるジョブとして出力する
+        for position in board.get_available_positions():
+            original_pos = board.make_move(position)
+            print(board.encode_state())
+            board.undo_move(position, original_pos)
+        return
+
+    residual_cache = None
+    if args.residual_cache > 0:
+        # 終盤の残余グラフの同型キャッシュを有効にする
+        residual_cache = ResidualCache(args.residual_cache)
+        if args.residual_table:
+            residual_cache.load(args.residual_table)
+        set_residual_cache(residual_cache)
+
+    bipartite_solver = None
+    if args.bipartite:
+        # 移動グラフが二部グラフなら、色の偶奇と最大マッチングで局面を展開せずに勝敗を決める
+        if board.color_mask is None:
+            print("移動グラフが二部グラフではないため、--bipartiteは使われません")
+        else:
+            bipartite_solver = BipartiteSolver()
+            set_bipartite_solver(bipartite_solver)
+
+    if args.play is not None:
+        run_play(board, args)
+        return
+
+    if args.perft:
+        # 探索は行わず、max_depthまでの合法な手順の数と移動生成の速さを測る
+        print_perft(run_perft(board, args.max_depth))
+        if args.perft_divide:
+            for position, count in perft_divide(board, args.max_depth):
+                row, col = divmod(position, args.width)
+                print(f"({row}, {col}): {count:,}")
+        return
+
+    if args.census:
+        # 探索は行わず、max_depthまでの深さごとの正準な状態の数を数える
+        levels, spilled_runs = run_census(board, args.max_depth, args.census_memory)
+        print_census(levels)
+        if spilled_runs > 0:
+            print(f"重複の除去でディスクに書き出したラン: {spilled_runs:,}個")
+        return
+
+    if args.estimate:
+        # 探索は行わず、局面数と時間の見積もりだけを表示する
+        estimate = estimate_search(
+            board,
+            args.heuristic,
+            args.max_depth,
+            args.estimate_nodes,
+            args.estimate_seconds,
+            args.batch_size,
+        )
+        if estimate.completed:
+            print("見積もりの予算内に探索が終わりました")
+        print(
+            f"見積もり探索局面数: {estimate.nodes:,.0f} "
+            f"(95%信頼区間: {estimate.nodes_low:,.0f}〜{estimate.nodes_high:,.0f})"
+        )
+        print(
+            f"見積もり探索時間: {format_seconds(estimate.seconds)} "
+            f"(95%信頼区間: {format_seconds(estimate.seconds_low)}〜"
+            f"{format_seconds(estimate.seconds_high)})"
+        )
+        print(f"見積もり時点の進捗: {estimate.progress:.4%}")
+        return
+
+    # 途中の状態では手数の偶奇で手番が決まる
+    player = board.get_current_player()
+
+    if args.tds > 0:
+        # 置換表をワーカーごとに分割するので、葉を評価しない厳密な探索に限る
+        if args.max_depth <= board.len - board.board.bit_count():
+            raise ValueError(
+                "--tdsはmax_depthが残りのマス数より大きい厳密な探索でのみ使えます"
+            )
+        # ワーカーは辞書の置換表で局面を展開するだけなので、探索と置換表の設定は使われない
+        ignored = [
+            option
+            for option, used in (
+                ("--bipartite", args.bipartite),
+                ("--compact-tt", args.compact_tt is not None),
+                ("--tt-spill", args.tt_spill is not None),
+                ("--tt-entries", args.tt_entries is not None),
+                ("--residual-cache", args.residual_cache > 0),
+                ("--report", args.report),
+                ("--collapsed", args.collapsed is not None),
+            )
+            if used
+        ]
+        if ignored:
+            raise ValueError(f"--tdsは{'、'.join(ignored)}と同時に使えません")
+
+    report = None
+    if args.report or args.collapsed:
+        # 内訳は逐次の探索でだけ記録するので、葉をまとめる探索では空になる
+        if args.batch_size > 0:
+            raise ValueError("--reportと--collapsedは--batch-sizeと同時に使えません")
+        # 手順ごとの内訳を記録する
+        report = SearchReport(args.width, args.collapsed_depth)
+        set_search_report(report)
+
+    compact_table = None
+    spilling_table = None
+    bounded_table = None
+    if args.compact_tt is not None and args.tt_spill is not None:
+        raise ValueError("--compact-ttは--tt-spillと同時に使えません")
+    if args.compact_tt is not None:
+        # 葉を評価すると勝率が勝敗以外の値になるので、厳密な探索に限る
+        if args.max_depth <= board.len - board.board.bit_count():
+            raise ValueError(
+                "--compact-ttはmax_depthが残りのマス数より大きい厳密な探索でのみ使えます"
+            )
+        compact_table = CompactTranspositionTable(args.compact_tt, args.tt_verify)
+        set_transposition_table(compact_table)
+    elif args.tt_spill is not None:
+        # メモリの層があふれたらディスクの層へ書き出す置換表にする
+        spilling_table = SpillingTranspositionTable(
+            args.tt_entries or DEFAULT_SPILL_MEMORY_ENTRIES, args.tt_spill
+        )
+        set_transposition_table(spilling_table)
+    elif args.tt_entries is not None:
+        # 登録数に上限のある世代付きの置換表にする
+        bounded_table = GenerationalTranspositionTable(args.tt_entries)
+        set_transposition_table(bounded_table)
+        begin_search(board, args.max_depth > board.len - board.board.bit_count())
+
+    two_level_table = None
+    if args.tt_l1 > 0 and args.tds == 0:
+        # 最近触れた局面を引く小さなL1を置換表の前に置く（--tdsではワーカーごとに置く）
+        main_table: MainTable = {}
+        for table in (compact_table, spilling_table, bounded_table):
+            if table is not None:
+                main_table = table
+        two_level_table = TwoLevelTranspositionTable(main_table, args.tt_l1)
+        set_transposition_table(two_level_table)
+
+    # 探索が例外で終わってもディスクの層のファイルを削除する
+    try:
+        shard_stats = None
+
+        def run_search() -> tuple[float, int]:
+            nonlocal shard_stats
+            if args.tds > 0:
+                # 局面を置換表のシャードを受け持つワーカーへ送って解く
+                mover_wins, shard_stats = solve_sharded(board, args.tds, args.tt_l1)
+                node_count = sum(shard.expanded for shard in shard_stats)
+                return (1.0 if mover_wins == player else 0.0), node_count
+            if args.batch_size > 0:
+                # 葉の評価をまとめて行う
+                return minimax_batched(
+                    board, player, args.heuristic, args.max_depth, args.batch_size
+                )
+            return minimax(
+                board, 0, player, args.verbose, args.heuristic, args.max_depth, 0.0, 1.0
+            )
+
+        profile = None
+        if args.profile is not None:
+            # プロファイラの下で探索し、統計とサンプルを書き出す
+            (first_player_win_prob, node_count), stats, sampler = profile_call(
+                run_search, args.profile, args.profile_interval
+            )
+            profile = (stats, sampler)
+        else:
+            first_player_win_prob, node_count = run_search()
+        if first_player_win_prob > 0.5:
+            print(f"先手必勝(先手勝率: {first_player_win_prob:.2%})")
+        else:
+            print(f"後手必勝(先手勝率: {first_player_win_prob:.2%})")
+        print(f"探索局面数: {node_count:,}")
+        if residual_cache is not None:
+            print(
+                f"残余グラフキャッシュ: ヒット {residual_cache.hits:,}回, "
+                f"ミス {residual_cache.misses:,}回, 登録数 {len(residual_cache.table):,}"
+            )
+        if bipartite_solver is not None:
+            print(
+                f"二部グラフ: マス数で決着 {bipartite_solver.count_settled:,}回, "
+                f"最大マッチングで決着 {bipartite_solver.matching_settled:,}回"
+            )
+        if shard_stats is not None:
+            for i, shard in enumerate(shard_stats):
+                print(
+                    f"シャード{i}: 展開 {shard.expanded:,}局面, 登録数 {shard.table_size:,}, "
+                    f"ヒット {shard.hits:,}回（うちL1 {shard.l1_hits:,}回）, "
+                    f"メッセージ 自分宛て {shard.local_messages:,} / "
+                    f"他のワーカー宛て {shard.remote_messages:,}"
+                )
+        if two_level_table is not None:
+            print_two_level_table_stats(two_level_table)
+        if compact_table is not None:
+            print_compact_table_stats(compact_table)
+        elif spilling_table is not None:
+            print_spilling_table_stats(spilling_table)
+        elif bounded_table is not None:
+            print(
+                f"置換表: 登録数 {len(bounded_table):,} / {bounded_table.max_entries:,}, "
+                f"ヒット {bounded_table.hits:,}回, 追い出し {bounded_table.evictions:,}回"
+            )
+        if report is not None:
+            if args.report:
+                report.print_table()
+            if args.collapsed:
+                report.write_collapsed(args.collapsed)
+        if args.symmetry_stats:
+            print_symmetry_stats(board)
+        if profile is not None:
+            print_hot_summary(profile[0], profile[1])
+            print(f"プロファイル: {args.profile}.pstats, {args.profile}.collapsed")
+    finally:
+        if spilling_table is not None:
+            spilling_table.close()
+
+
+def create_board(
+    args: argparse.Namespace, ordering_weights: dict[str, float] | None
+) -> Board:
+    """引数に従ってチェスボードを作り、途中の状態が指定されていれば設定する
+
+    Args:
+        args (argparse.Namespace): コマンドライン引数
+        ordering_weights (dict[str, float] | None): 移動順序のヒューリスティクスの重み
+
+    Returns:
+        Board: チェスボード
+    """
+    static_weights = None
+    if args.leaf_eval == "static":
+        static_weights = load_static_weights(
+            args.static_weights, args.piece_type, (args.height, args.width)
+        )
     board = Board(
         (args.height, args.width),  # ボードサイズ
         (args.initial_row, args.initial_col),  # 駒の初期位置
         args.piece_type,
         args.num_playout,
+        args.playout_policy,
+        args.epsilon,
+        args.seed,
+        args.workers,
+        args.parallel_threshold,
+        args.exact_threshold,
+        args.canonical_depth,
+        args.canonical_min_empty,
+        args.symmetry_stats,
+        ordering_weights,
+        static_weights,
     )
-    board.print_board()
+    if args.state is not None:
+        # 途中の状態から探索する
+        board.set_state(*board.decode_state(args.state))
+    elif args.visited is not None:
+        # 駒の初期位置を訪問済みのマスに加えて途中の状態とする
+        board.set_state(*board.validate_state(args.visited | board.board, board.pos))
+    return board
+
+
+def run_play(board: Board, args: argparse.Namespace):
+    """勝敗の表を読み込むか事前計算して、ユーザーとエンジンで対局する
+
+    Args:
+        board (Board): 対局を始めるチェスボードの状態
+        args (argparse.Namespace): コマンドライン引数
+    """
+    store = SolvedStore(board)
+    if args.play_store is not None and os.path.exists(args.play_store):
+        store.load(args.play_store)
+        print(f"勝敗の表を読み込みました: 登録数 {len(store.results):,}")
+    if args.play_precompute > 0:
+        # 現在の状態から時間の予算の範囲で解き、表を埋めておく
+        set_transposition_table(store.results)
+        start = time.perf_counter()
+        result = solve_with_budget(
+            board, board.get_current_player(), True, args.play_precompute
+        )
+        print(
+            f"事前計算: {'完了' if result is not None else '打ち切り'} "
+            f"({time.perf_counter() - start:.1f}秒), 登録数 {len(store.results):,}"
+        )
+    try:
+        play(board, store, args.play == "first", True, args.think_seconds)
+    finally:
+        if args.play_store is not None:
+            store.save(args.play_store)
+
+
+def print_compact_table_stats(table: CompactTranspositionTable):
+    """コンパクトな置換表の統計を表示する
 
-    first_player_win_prob, node_count = minimax(
-        board, 0, True, args.verbose, args.heuristic, args.max_depth, 0.0, 1.0
+    Args:
+        table (CompactTranspositionTable): コンパクトな置換表
+    """
+    print(
+        f"置換表: 登録数 {len(table):,} / {table.capacity:,} "
+        f"({table.nbytes / (1 << 20):.1f}MB), 参照 {table.lookups:,}回, "
+        f"ヒット {table.hits:,}回, 追い出し {table.evictions:,}回"
     )
-    if first_player_win_prob > 0.5:
-        print(f"先手必勝(先手勝率: {first_player_win_prob:.2%})")
-    else:
-        print(f"後手必勝(先手勝率: {first_player_win_prob:.2%})")
-    print(f"探索局面数: {node_count:,}")
+    print(f"置換表の誤検出の期待値: {table.expected_false_positives:.2e}回")
+    if table.verify:
+        print(f"置換表の誤検出: {table.false_positives:,}回")
+    elif table.expected_false_positives > 0.01:
+        print("誤検出の期待値が大きいため、--tt-verifyでの検証を推奨します")
 
 
-if __name__ == "__main__":
+def print_two_level_table_stats(table: TwoLevelTranspositionTable):
+    """2段の置換表の段ごとのヒット率を表示する
+
+    Args:
+        table (TwoLevelTranspositionTable): 2段の置換表
+    """
+    lookups = max(table.lookups, 1)
+    main_lookups = max(table.lookups - table.l1_hits, 1)
+    print(
+        f"置換表のL1: {table.l1_entries:,}スロット, 参照 {table.lookups:,}回, "
+        f"L1ヒット率 {table.l1_hits / lookups:.2%}, "
+        f"下の段のヒット率 {table.main_hits / main_lookups:.2%}（L1で外れた参照のうち）"
+    )
+
+
+def print_spilling_table_stats(table: SpillingTranspositionTable):
+    """ディスクへ書き出す置換表の統計を表示する
+
+    Args:
+        table (SpillingTranspositionTable): ディスクへ書き出す置換表
+    """
+    print(
+        f"置換表: メモリ {table.memory_entries:,} / {table.max_entries:,}, "
+        f"ディスク {table.disk_records:,} ({table.disk_bytes / (1 << 20):.1f}MB), "
+        f"参照 {table.lookups:,}回"
+    )
+    print(
+        f"置換表のヒット: メモリ {table.memory_hits:,}回, ディスク {table.disk_hits:,}回, "
+        f"フィルタで除外 {table.filter_rejects:,}回, フィルタの偽陽性 {table.disk_misses:,}回"
+    )
+    print(
+        f"置換表の書き出し: {table.spills:,}回, コンパクション {table.compactions:,}回"
+    )
+
+
+def print_symmetry_stats(board: Board):
+    """深さごとの対称変換による正規化の統計を表示する
+
+    Args:
+        board (Board): 探索に使ったチェスボード
+    """
+    print("深さ 正規化 非正規化 変換 統合 正規化時間(ms)")
+    for depth in range(board.len):
+        if board.canonical_counts[depth] == 0 and board.raw_key_counts[depth] == 0:
+            continue
+        print(
+            f"{depth:4d} {board.canonical_counts[depth]:8,d} "
+            f"{board.raw_key_counts[depth]:8,d} {board.transformed_counts[depth]:8,d} "
+            f"{board.symmetry_merges[depth]:8,d} "
+            f"{board.canonical_times[depth] * 1000:10.1f}"
+        )
+
+
+def build_parser() -> argparse.ArgumentParser:
+    """main.pyのコマンドライン引数のパーサーを作る（バッチランナーもジョブの引数の解釈に使う）
+
+    Returns:
+        argparse.ArgumentParser: コマンドライン引数のパーサー
+    """
     parser = argparse.ArgumentParser(description="チェスの駒を動かすゲームの探索")
     parser.add_argument(
         "height",
@@ -70,5 +497,268 @@ if __name__ == "__main__":
         action="store_true",
         help="ヒューリスティクスの利用",
     )
-    args = parser.parse_args()
-    main(args)
+    parser.add_argument(
+        "--playout-policy",
+        type=str,
+        choices=list(PLAYOUT_POLICIES),
+        default="random",
+        help="プレイアウトで手を選ぶ方策",
+    )
+    parser.add_argument(
+        "--leaf-eval",
+        type=str,
+        choices=["playout", "static"],
+        default="playout",
+        help="max_depthで打ち切った葉の評価方法",
+    )
+    parser.add_argument(
+        "--static-weights",
+        type=str,
+        default=DEFAULT_STATIC_WEIGHTS,
+        help="葉の静的評価の重みのプロファイルのファイルパス（modules/calibration.pyで作成）",
+    )
+    parser.add_argument(
+        "--epsilon",
+        type=float,
+        default=0.1,
+        help="epsilon-greedy方策でランダムに手を選ぶ確率",
+    )
+    parser.add_argument(
+        "--seed",
+        type=int,
+        default=None,
+        help="プレイアウトの乱数シード",
+    )
+    parser.add_argument(
+        "--workers",
+        type=int,
+        default=1,
+        help="プレイアウトを並列実行するワーカープロセス数",
+    )
+    parser.add_argument(
+        "--parallel-threshold",
+        type=int,
+        default=2000,
+        help="並列実行を行うプレイアウト回数の下限",
+    )
+    parser.add_argument(
+        "--exact-threshold",
+        type=int,
+        default=10,
+        help="プレイアウトの代わりに厳密な勝率を計算する到達可能マス数の上限（0なら計算しない）",
+    )
+    parser.add_argument(
+        "--residual-cache",
+        type=int,
+        default=0,
+        help="残余グラフの同型キャッシュを使う頂点数の上限（0なら使わない、31以下）",
+    )
+    parser.add_argument(
+        "--residual-table",
+        type=str,
+        default=DEFAULT_RESIDUAL_TABLE,
+        help="事前計算した残余グラフの勝敗表のファイルパス",
+    )
+    parser.add_argument(
+        "--tds",
+        type=int,
+        default=0,
+        metavar="N",
+        help="置換表をN個のワーカーに分割して局面を担当のワーカーへ送って解く（0なら使わない、厳密な探索のみ）。"
+        "置換表のメモリを分散する代わりに遅く、差分テストでは逐次の探索の0.01〜0.12倍の速さ",
+    )
+    parser.add_argument(
+        "--bipartite",
+        action="store_true",
+        help="移動グラフが二部グラフなら色ごとのマス数と最大マッチングで勝敗を決める",
+    )
+    parser.add_argument(
+        "--canonical-depth",
+        type=int,
+        default=None,
+        help="対称変換による正規化を行う深さの上限",
+    )
+    parser.add_argument(
+        "--canonical-min-empty",
+        type=int,
+        default=None,
+        help="対称変換による正規化を行う未訪問マス数の下限",
+    )
+    parser.add_argument(
+        "--symmetry-stats",
+        action="store_true",
+        help="深さごとの対称変換による正規化の統計を表示する",
+    )
+    parser.add_argument(
+        "--weights",
+        type=str,
+        default=None,
+        help="移動順序の重みのプロファイルのファイルパス（modules/tuning.pyで作成）",
+    )
+    parser.add_argument(
+        "--perft",
+        action="store_true",
+        help="探索を行わず、max_depthまでの合法な手順の数と移動生成の速さを測る",
+    )
+    parser.add_argument(
+        "--perft-divide",
+        action="store_true",
+        help="--perftで最初の手ごとの手順の数も表示する",
+    )
+    parser.add_argument(
+        "--census",
+        action="store_true",
+        help="探索を行わず、max_depthまでの深さごとの正準な状態の数を数える",
+    )
+    parser.add_argument(
+        "--census-memory",
+        type=int,
+        default=5_000_000,
+        metavar="N",
+        help="--censusで深さごとにメモリ上で重複を除く状態数の上限（超えるとディスクに書き出す）",
+    )
+    parser.add_argument(
+        "--estimate",
+        action="store_true",
+        help="探索を行わず、探索局面数と探索時間の見積もりを表示する",
+    )
+    parser.add_argument(
+        "--estimate-nodes",
+        type=int,
+        default=None,
+        help="見積もりのために探索する局面数の上限",
+    )
+    parser.add_argument(
+        "--estimate-seconds",
+        type=float,
+        default=10.0,
+        help="見積もりのために探索する時間の上限（秒）",
+    )
+    parser.add_argument(
+        "--state",
+        type=str,
+        default=None,
+        help="途中の状態（「駒の位置:盤面の16進数」の文字列）から探索する",
+    )
+    parser.add_argument(
+        "--visited",
+        type=lambda value: int(value, 0),
+        default=None,
+        help="訪問済みのマスのビットマスク（0x付きで16進数も可）。駒の位置は初期位置を使う",
+    )
+    parser.add_argument(
+        "--split",
+        action="store_true",
+        help="探索せず、各手の後の状態を1行ずつ出力する",
+    )
+    parser.add_argument(
+        "--report",
+        action="store_true",
+        help="ルートの手と2手目ごとの局面数・置換表ヒット数・時間・結果を表示する",
+    )
+    parser.add_argument(
+        "--collapsed",
+        type=str,
+        default=None,
+        help="手順ごとの局面数をcollapsed stack形式（flamegraph用）で書き出すファイルパス",
+    )
+    parser.add_argument(
+        "--collapsed-depth",
+        type=int,
+        default=8,
+        help="collapsed stackで区別する手順の深さの上限",
+    )
+    parser.add_argument(
+        "--plan",
+        type=str,
+        choices=["exact", "approximate", "auto", "length"],
+        default=None,
+        help="求める出力から探索の設定を自動で選ぶ（max_depthなどの指定は上書きされる）。"
+        "lengthなら探索せずにゲームの長さの見積もりだけを表示する",
+    )
+    parser.add_argument(
+        "--plan-seconds",
+        type=float,
+        default=600.0,
+        help="--plan autoで厳密解を選ぶ探索時間の見積もりの上限（秒）",
+    )
+    parser.add_argument(
+        "--compact-tt",
+        type=float,
+        default=None,
+        help="置換表を指定した大きさ（MB）のコンパクトな表にする（厳密な探索のみ）",
+    )
+    parser.add_argument(
+        "--tt-entries",
+        type=int,
+        default=None,
+        help="置換表の登録数の上限（超えると価値の低い局面から捨てる）",
+    )
+    parser.add_argument(
+        "--tt-spill",
+        type=str,
+        default=None,
+        help="置換表のメモリの層（登録数の上限は--tt-entries）からあふれた局面を書き出すファイルパス",
+        metavar="PATH",
+    )
+    parser.add_argument(
+        "--tt-l1",
+        type=int,
+        default=0,
+        metavar="N",
+        help="置換表の前に置く直接写像の小さな表（L1）のスロット数（0なら置かない、--tdsではワーカーごと）",
+    )
+    parser.add_argument(
+        "--tt-verify",
+        action="store_true",
+        help="コンパクトな置換表で完全なキーも記録し、誤検出を検証する",
+    )
+    parser.add_argument(
+        "--profile",
+        type=str,
+        default=None,
+        help="探索をプロファイラの下で実行し、PREFIX.pstatsとPREFIX.collapsedに書き出す",
+        metavar="PREFIX",
+    )
+    parser.add_argument(
+        "--profile-interval",
+        type=float,
+        default=0.001,
+        help="--profileでスタックをサンプリングする間隔（秒）",
+    )
+    parser.add_argument(
+        "--play",
+        type=str,
+        choices=["first", "second"],
+        default=None,
+        help="ユーザーが先手（first）か後手（second）でエンジンと対局する",
+    )
+    parser.add_argument(
+        "--play-store",
+        type=str,
+        default=None,
+        help="対局で使う勝敗の表のファイルパス（あれば読み込み、終了時に書き出す）",
+    )
+    parser.add_argument(
+        "--play-precompute",
+        type=float,
+        default=30.0,
+        help="対局前に勝敗の表を事前計算する時間の上限（秒）",
+    )
+    parser.add_argument(
+        "--think-seconds",
+        type=float,
+        default=1.0,
+        help="表にない状態でエンジンが探索する時間の上限（秒）",
+    )
+    parser.add_argument(
+        "--batch-size",
+        type=int,
+        default=0,
+        help="葉の評価をまとめて行う際の1回あたりの葉の数（0ならまとめない）",
+    )
+    return parser
+
+
+if __name__ == "__main__":
+    main(build_parser().parse_args())
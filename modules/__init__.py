@@ -1,6 +1,15 @@
 """チェス探索モジュール"""
 
-from .minimax import minimax
+from .minimax import minimax, minimax_batched, set_residual_cache
 from .board import Board
+from .playout import PLAYOUT_POLICIES
+from .residual import ResidualCache
 
-__all__ = ["minimax", "Board"]
+__all__ = [
+    "minimax",
+    "minimax_batched",
+    "set_residual_cache",
+    "Board",
+    "PLAYOUT_POLICIES",
+    "ResidualCache",
+]
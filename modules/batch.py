@@ -0,0 +1,195 @@
+"""見積もりに基づいて探索ジョブを順序付けて実行するバッチランナー
+
+ジョブファイルの各行にはmain.pyに渡す引数を書く（空行と#で始まる行は無視する）。
+各ジョブの探索時間を見積もり、短いものから順に、予算内に収まるものだけを実行する。
+"""
+
+import argparse
+import importlib.util
+import os
+import shlex
+import subprocess
+import sys
+import time
+
+from .board import Board
+from .estimate import SearchEstimate, estimate_search, format_seconds
+from .minimax import (
+    set_bipartite_solver,
+    set_residual_cache,
+    set_transposition_table,
+)
+from .parity import BipartiteSolver
+from .residual import ResidualCache
+from .ttable import CompactTranspositionTable, GenerationalTranspositionTable
+from .tuning import load_ordering_weights
+
+MAIN_PATH = os.path.join(os.path.dirname(os.path.dirname(__file__)), "main.py")
+
+
+def load_main_module():
+    """ジョブの引数をmain.pyと同じように解釈するため、main.pyをモジュールとして読み込む
+
+    Returns:
+        module: main.pyのモジュール
+    """
+    spec = importlib.util.spec_from_file_location("main", MAIN_PATH)
+    assert spec is not None and spec.loader is not None
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def read_jobs(path: str) -> list[list[str]]:
+    """ジョブファイルを読み込む
+
+    Args:
+        path (str): ジョブファイルのパス
+
+    Returns:
+        list[list[str]]: 各ジョブのmain.pyへの引数のリスト
+    """
+    jobs: list[list[str]] = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if line and not line.startswith("#"):
+                jobs.append(shlex.split(line))
+    return jobs
+
+
+def configure_engine(job: argparse.Namespace, board: Board, spill_entries: int):
+    """ジョブと同じ残余グラフキャッシュ、二部グラフのソルバー、置換表を探索に設定する
+
+    ディスクへ書き出す置換表の代わりには、そのメモリの層と同じ大きさの世代付きの置換表を使う。
+
+    Args:
+        job (argparse.Namespace): main.pyのパーサーで解釈したジョブの引数
+        board (Board): ジョブのチェスボード
+        spill_entries (int): --tt-entriesがない場合のディスクへ書き出す置換表のメモリの層の登録数
+    """
+    if job.residual_cache > 0:
+        residual_cache = ResidualCache(job.residual_cache)
+        if job.residual_table:
+            residual_cache.load(job.residual_table)
+        set_residual_cache(residual_cache)
+    if job.bipartite and board.color_mask is not None:
+        set_bipartite_solver(BipartiteSolver())
+    if job.compact_tt is not None:
+        set_transposition_table(CompactTranspositionTable(job.compact_tt, False))
+    elif job.tt_spill is not None:
+        set_transposition_table(
+            GenerationalTranspositionTable(job.tt_entries or spill_entries)
+        )
+    elif job.tt_entries is not None:
+        set_transposition_table(GenerationalTranspositionTable(job.tt_entries))
+
+
+def reset_engine():
+    """configure_engineで設定したものを外し、既定の探索に戻す"""
+    set_residual_cache(None)
+    set_bipartite_solver(None)
+    set_transposition_table({})
+
+
+def estimate_job(
+    job: argparse.Namespace, main_module, time_budget: float
+) -> SearchEstimate:
+    """ジョブの探索時間を、ジョブと同じ探索の設定で見積もる
+
+    Args:
+        job (argparse.Namespace): main.pyのパーサーで解釈したジョブの引数
+        main_module (module): main.py（create_boardで途中の状態や正規化の方針もジョブと同じにする）
+        time_budget (float): 見積もりのために探索する時間の上限（秒）
+
+    Returns:
+        SearchEstimate: 見積もり結果
+    """
+    ordering_weights = None
+    if job.weights:
+        ordering_weights = load_ordering_weights(
+            job.weights, job.piece_type, (job.height, job.width)
+        )
+    with main_module.create_board(job, ordering_weights) as board:
+        configure_engine(job, board, main_module.DEFAULT_SPILL_MEMORY_ENTRIES)
+        try:
+            return estimate_search(
+                board,
+                job.heuristic,
+                job.max_depth,
+                None,
+                time_budget,
+                job.batch_size,
+            )
+        finally:
+            reset_engine()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="見積もりに基づく探索ジョブの実行")
+    parser.add_argument("jobs", type=str, help="ジョブファイルのパス")
+    parser.add_argument(
+        "--budget",
+        type=float,
+        default=3600.0,
+        help="全ジョブの実行時間の予算（秒）",
+    )
+    parser.add_argument(
+        "--estimate-seconds",
+        type=float,
+        default=5.0,
+        help="1ジョブの見積もりのために探索する時間の上限（秒）",
+    )
+    parser.add_argument(
+        "--dry-run",
+        action="store_true",
+        help="見積もりと実行計画の表示だけを行う",
+    )
+    args = parser.parse_args()
+
+    jobs = read_jobs(args.jobs)
+    main_module = load_main_module()
+    job_parser = main_module.build_parser()
+    planned: list[tuple[SearchEstimate, list[str]]] = []
+    for job in jobs:
+        command = " ".join(job)
+        try:
+            parsed = job_parser.parse_args(job)
+        except SystemExit:
+            # 解釈できない行はパーサーがエラーを表示して終了しようとするので、そのジョブだけ失敗とする
+            print(f"[{command}] 引数を解釈できないため失敗としました")
+            continue
+        try:
+            planned.append(
+                (estimate_job(parsed, main_module, args.estimate_seconds), job)
+            )
+        except ValueError as e:
+            print(f"[{command}] 見積もりに失敗しました: {e}")
+    # 見積もり時間の短い順に実行する
+    planned.sort(key=lambda item: item[0].seconds)
+
+    remaining = args.budget
+    for estimate, job in planned:
+        command = " ".join(job)
+        print(
+            f"[{command}] 見積もり {format_seconds(estimate.seconds)} "
+            f"({format_seconds(estimate.seconds_low)}〜"
+            f"{format_seconds(estimate.seconds_high)})"
+        )
+        if estimate.seconds > remaining:
+            # 見積もりが残りの予算を超えるジョブは実行しない
+            print("  予算を超えるため実行しません")
+            continue
+        if args.dry_run:
+            remaining -= estimate.seconds
+            continue
+
+        start = time.perf_counter()
+        try:
+            subprocess.run(
+                [sys.executable, MAIN_PATH, *job], timeout=remaining, check=False
+            )
+        except subprocess.TimeoutExpired:
+            print("  予算を使い切ったため打ち切りました")
+        remaining -= time.perf_counter() - start
+        print(f"  残り予算 {format_seconds(max(0.0, remaining))}")
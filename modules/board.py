@@ -1,6 +1,13 @@
 """チェスボードの定義"""
 
+import multiprocessing
 import random
+import time
+from multiprocessing.pool import Pool
+from typing import Self
+
+from .evaluation import bipartite_color_mask, static_win_probability
+from .playout import PLAYOUT_POLICIES, init_playout_worker, run_playouts_in_worker
 
 # (directions, is_unlimited) の形式で駒の移動設定を定義
 PIECE_MOVE_CONFIG = {
@@ -54,6 +61,13 @@ PIECE_MOVE_CONFIG = {
     ),
 }
 
+# 移動順序のヒューリスティクスの特徴量ごとの重み（既定値）
+# mobility: 移動先から動けるマス数, center: 移動先の中心からの距離, onward: 移動後に相手が動ける手の数
+DEFAULT_ORDERING_WEIGHTS = {"mobility": -5.0, "center": 1.0, "onward": 0.0}
+
+# 統合の判定用に記録する正規化前の盤面の数の上限（超えたら記録を空にする）
+SEEN_RAW_KEYS_LIMIT = 1_000_000
+
 
 class Board:
     def __init__(
@@ -62,6 +76,17 @@ class Board:
         initial_position: tuple[int, int],
         piece_type: str,
         num_playout: int,
+        playout_policy: str = "random",
+        playout_epsilon: float = 0.1,
+        seed: int | None = None,
+        num_workers: int = 1,
+        parallel_threshold: int = 2000,
+        exact_threshold: int = 10,
+        canonical_max_depth: int | None = None,
+        canonical_min_empty: int | None = None,
+        symmetry_stats: bool = False,
+        ordering_weights: dict[str, float] | None = None,
+        static_weights: dict[str, float] | None = None,
     ):
         """ゲーム状態を表すチェスボードを初期化する
 
@@ -70,6 +95,18 @@ class Board:
             initial_position (tuple[int, int]): 駒の初期位置（縦, 横）
             piece_type (str): 駒の種類（"rook", "king", "queen", "knight"）
             num_playout (int): プレイアウトの試行回数
+            playout_policy (str): プレイアウトで手を選ぶ方策（"random", "warnsdorff", "epsilon-greedy", "win-aware"）
+            playout_epsilon (float): epsilon-greedy方策でランダムに手を選ぶ確率
+            seed (int | None): プレイアウトの乱数シード（Noneなら再現性なし）
+            num_workers (int): プレイアウトを並列実行するワーカープロセス数（1なら並列化しない）
+            parallel_threshold (int): 並列実行を行うプレイアウト回数の下限
+            exact_threshold (int): プレイアウトの代わりに厳密な勝率を計算する到達可能マス数の上限（0なら計算しない）
+            canonical_max_depth (int | None): 対称変換による正規化を行う深さの上限
+            canonical_min_empty (int | None): 対称変換による正規化を行う未訪問マス数の下限
+                （両方Noneなら常に正規化し、どちらかを指定した場合はいずれかの条件を満たすときだけ正規化する）
+            symmetry_stats (bool): 対称変換による統合の回数を記録するかどうか
+            ordering_weights (dict[str, float] | None): 移動順序のヒューリスティクスの重み（Noneなら既定値）
+            static_weights (dict[str, float] | None): 葉の静的評価の重み（Noneならプレイアウトで評価する）
         """
         if not (0 < size[0] <= 8 and 0 < size[1] <= 8):
             raise ValueError("ボードのサイズは1から8の範囲で指定してください")
@@ -115,8 +152,75 @@ class Board:
             self.available_positions_map[i].bit_count() for i in range(self.len)
         ]
 
+        # 静的評価用の移動グラフの2色塗り（二部グラフでなければNone）
+        self.color_mask = bipartite_color_mask(self.available_positions_map)
+        self.static_weights = static_weights
+
+        # ヒューリスティクスの特徴量ごとの重み（指定のない特徴量は既定値）
+        self.ordering_weights = DEFAULT_ORDERING_WEIGHTS | (ordering_weights or {})
+        if set(self.ordering_weights) != set(DEFAULT_ORDERING_WEIGHTS):
+            raise ValueError("対応していないヒューリスティクスの特徴量です")
+
         self.num_playout = num_playout
 
+        if playout_policy not in PLAYOUT_POLICIES:
+            raise ValueError("対応していないプレイアウト方策です")
+        self.playout_policy = playout_policy
+        self.playout_epsilon = playout_epsilon
+        self.rng = random.Random(seed)
+
+        if num_workers < 1:
+            raise ValueError("ワーカー数は1以上で指定してください")
+        self.num_workers = num_workers
+        self.parallel_threshold = parallel_threshold
+        # ワーカープロセスのプールは必要になったときに作成する
+        self._pool: Pool | None = None
+
+        # ランダムプレイ時の厳密な先手勝率のメモ (状態キー -> 先手勝率)
+        self.exact_threshold = exact_threshold
+        self._random_play_memo: dict[int, float] = {}
+
+        # 対称変換による正規化の方針
+        if canonical_max_depth is None and canonical_min_empty is None:
+            canonical_max_depth = self.len
+        self.canonical_max_depth = (
+            -1 if canonical_max_depth is None else canonical_max_depth
+        )
+        self.canonical_min_empty = (
+            self.len + 1 if canonical_min_empty is None else canonical_min_empty
+        )
+
+        # 深さ（初期配置からの手数）ごとの正規化の統計
+        self.canonical_counts = [0] * self.len  # 正規化した回数
+        self.raw_key_counts = [0] * self.len  # 正規化せずにキーを作った回数
+        self.transformed_counts = [0] * self.len  # 正規化で盤面が変わった回数
+        self.symmetry_merges = [0] * self.len  # 対称な別の局面の結果を使えた回数
+        self.canonical_times = [0.0] * self.len  # 正規化にかかった時間（秒）
+        # 統合の判定用に、探索中にキーを作った正規化前の盤面を記録する（探索ごと、上限を超えたら空にする）
+        self.symmetry_stats = symmetry_stats
+        self._seen_raw_keys: set[int] = set()
+        # 直前に作ったキーの元の盤面が初めて現れたものかどうか
+        self._last_raw_key_new = False
+
+    def __getstate__(self) -> dict:
+        # プールはワーカープロセスへ渡せないので除外する
+        state = self.__dict__.copy()
+        state["_pool"] = None
+        return state
+
+    def __enter__(self) -> Self:
+        return self
+
+    def __exit__(self, *exc_info):
+        self.close()
+
+    def close(self):
+        """プレイアウト用のワーカープロセスを終了する"""
+        if self._pool is not None:
+            self._pool.close()
+            self._pool.join()
+            self._pool = None
+
     def get_state(self) -> tuple[int, int]:
         """現在のボードの状態を取得する
 
@@ -135,6 +239,71 @@ class Board:
         self.board = board
         self.pos = position
 
+    def get_key_signature(self) -> tuple:
+        """状態キーの意味を決めるボードの設定を返す（同じ設定のボードの間でだけ状態キーを比べられる）
+
+        Returns:
+            tuple: (ボードのサイズ, 駒の種類, 正規化を行う深さの上限, 正規化を行う未訪問マス数の下限)
+        """
+        return (
+            self.size,
+            self.piece_type,
+            self.canonical_max_depth,
+            self.canonical_min_empty,
+        )
+
+    def get_current_player(self) -> bool:
+        """現在の手番を返す（初期配置からの手数の偶奇で決まる）
+
+        Returns:
+            bool: 現在の手番（True: 先手, False: 後手）
+        """
+        return (self.board.bit_count() - 1) % 2 == 0
+
+    def encode_state(self) -> str:
+        """現在のボードの状態を「駒の位置:盤面の16進数」の文字列にする
+
+        Returns:
+            str: 状態の文字列（例: "12:1f3a"）
+        """
+        return f"{self.pos}:{self.board:x}"
+
+    def decode_state(self, encoded: str) -> tuple[int, int]:
+        """encode_stateの文字列を盤面と駒の位置に戻す
+
+        Args:
+            encoded (str): 状態の文字列
+
+        Returns:
+            tuple[int, int]: (盤面のビット表現, 駒の位置のインデックス)
+        """
+        try:
+            position_str, board_str = encoded.split(":")
+            position, board = int(position_str), int(board_str, 16)
+        except ValueError:
+            raise ValueError(
+                "状態の文字列は「駒の位置:盤面の16進数」で指定してください"
+            ) from None
+        return self.validate_state(board, position)
+
+    def validate_state(self, board: int, position: int) -> tuple[int, int]:
+        """途中の状態がこのボードで有効かを確認する
+
+        Args:
+            board (int): 盤面のビット表現
+            position (int): 駒の位置のインデックス
+
+        Returns:
+            tuple[int, int]: (盤面のビット表現, 駒の位置のインデックス)
+        """
+        if not 0 <= position < self.len:
+            raise ValueError("駒の位置がボードの範囲外です")
+        if board >> self.len or board < 0:
+            raise ValueError("盤面にボードの範囲外のマスが含まれています")
+        if not (board >> position) & 1:
+            raise ValueError("駒の位置は訪問済みである必要があります")
+        return board, position
+
     def make_move(self, position: int) -> int:
         """駒を新しい位置に移動し、その位置を訪問済みとしてマークする
 
@@ -203,8 +372,46 @@ class Board:
             available_positions &= available_positions - 1
         return positions
 
+    def get_leaf_result(self, current_player: bool) -> float:
+        """探索を打ち切った葉の局面の先手の勝利確率を返す
+
+        静的評価の重みがあれば静的評価で、なければプレイアウトで求める。
+
+        Args:
+            current_player (bool): 現在の手番（True: 先手, False: 後手）
+
+        Returns:
+            float: 先手の勝利確率
+        """
+        if self.static_weights is None:
+            return self.get_playout_result(current_player)
+        win_prob = static_win_probability(self, self.static_weights)
+        return win_prob if current_player else 1.0 - win_prob
+
+    def get_leaf_results(self, states: list[tuple[int, int, bool]]) -> list[float]:
+        """複数の葉の局面の先手の勝利確率をまとめて返す
+
+        Args:
+            states (list[tuple[int, int, bool]]): (盤面, 駒の位置, 手番) のリスト
+
+        Returns:
+            list[float]: 各状態の先手の勝利確率
+        """
+        if self.static_weights is None:
+            return self.get_playout_results(states)
+        current_board, current_pos = self.get_state()
+        results: list[float] = []
+        for board, position, player in states:
+            self.set_state(board, position)
+            results.append(self.get_leaf_result(player))
+        self.set_state(current_board, current_pos)
+        return results
+
     def get_playout_result(self, current_player: bool) -> float:
-        """ランダムに手を選んでゲームを進めた場合に先手が勝つ確率を返す
+        """プレイアウト方策に従って手を選んでゲームを進めた場合に先手が勝つ確率を返す
+
+        プレイアウト回数がparallel_threshold以上かつワーカー数が2以上なら、ワーカープロセスに分割して実行する。
+        各ワーカーの乱数シードはself.rngから決めるため、同じシードとワーカー数なら結果は再現する。
 
         Args:
             current_player (bool): 現在の手番（True: 先手, False: 後手）
@@ -212,28 +419,185 @@ class Board:
         Returns:
             float: 先手の勝利確率
         """
-        first_player_wins = 0
+        if self._can_compute_random_play_result():
+            # 残りが小さければサンプリングせず厳密に計算する
+            return self.get_random_play_result(current_player)
+
+        if self.num_workers == 1 or self.num_playout < self.parallel_threshold:
+            first_player_wins = self.count_playout_wins(
+                self.board, self.pos, current_player, self.num_playout
+            )
+            return first_player_wins / self.num_playout
+
+        # プレイアウトをワーカー数で均等に分割し、それぞれに独立したシードを割り当てる
+        chunk, remainder = divmod(self.num_playout, self.num_workers)
+        tasks = [
+            (
+                self.board,
+                self.pos,
+                current_player,
+                self.rng.getrandbits(64),
+                chunk + (1 if i < remainder else 0),
+            )
+            for i in range(self.num_workers)
+        ]
+        first_player_wins = sum(self._get_pool().map(run_playouts_in_worker, tasks))
+        return first_player_wins / self.num_playout
+
+    def get_playout_results(self, states: list[tuple[int, int, bool]]) -> list[float]:
+        """複数の状態に対するプレイアウトをまとめて実行し、それぞれの先手の勝利確率を返す
+
+        合計のプレイアウト回数がparallel_threshold以上かつワーカー数が2以上なら、状態ごとにワーカープロセスへ分配する。
+        乱数シードは状態の順にself.rngから決めるため、同じシードとワーカー数なら結果は再現する。
+
+        Args:
+            states (list[tuple[int, int, bool]]): (盤面, 駒の位置, 手番) のリスト
+
+        Returns:
+            list[float]: 各状態の先手の勝利確率
+        """
+        results: list[float] = [0.0] * len(states)
+
+        # 残りが小さい状態は厳密に計算し、それ以外をプレイアウトに回す
+        pending: list[int] = []
         current_board, current_pos = self.get_state()
-        for _ in range(self.num_playout):
+        for i, (board, position, player) in enumerate(states):
+            self.set_state(board, position)
+            if self._can_compute_random_play_result():
+                results[i] = self.get_random_play_result(player)
+            else:
+                pending.append(i)
+        self.set_state(current_board, current_pos)
+
+        if (
+            self.num_workers == 1
+            or len(pending) * self.num_playout < self.parallel_threshold
+        ):
+            for i in pending:
+                board, position, player = states[i]
+                wins = self.count_playout_wins(
+                    board, position, player, self.num_playout
+                )
+                results[i] = wins / self.num_playout
+            return results
+
+        tasks = [
+            (*states[i], self.rng.getrandbits(64), self.num_playout) for i in pending
+        ]
+        # 1タスクが小さいので、ある程度まとめてワーカーに渡す
+        chunksize = max(1, len(tasks) // (self.num_workers * 4))
+        wins_list = self._get_pool().map(run_playouts_in_worker, tasks, chunksize)
+        for i, wins in zip(pending, wins_list):
+            results[i] = wins / self.num_playout
+        return results
+
+    def get_random_play_result(self, current_player: bool) -> float:
+        """両者が一様ランダムに手を選ぶ場合に先手が勝つ確率を厳密に計算する
+
+        各合法手の先の勝率の平均を再帰的に求め、状態キーでメモ化する。
+        計算量は残りの到達可能マス数に対して指数的なので、小さい状態にのみ使う。
+
+        Args:
+            current_player (bool): 現在の手番（True: 先手, False: 後手）
+
+        Returns:
+            float: 先手の勝利確率
+        """
+        # プレイアウトの代わりの計算なので、探索の正規化の統計には数えない
+        state_key = self.get_state_key(record_stats=False)
+        if state_key in self._random_play_memo:
+            return self._random_play_memo[state_key]
+
+        available_positions = self.get_available_positions()
+        if not available_positions:
+            # 現在のプレイヤーの負け
+            first_player_win_prob = 0.0 if current_player else 1.0
+        else:
+            total = 0.0
+            for position in available_positions:
+                original_pos = self.make_move(position)
+                total += self.get_random_play_result(not current_player)
+                self.undo_move(position, original_pos)
+            first_player_win_prob = total / len(available_positions)
+
+        self._random_play_memo[state_key] = first_player_win_prob
+        return first_player_win_prob
+
+    def get_reachable_mask(self) -> int:
+        """現在の位置から未訪問のマスだけを辿って到達できるマスのビットマスクを返す
+
+        Returns:
+            int: 到達可能なマスのビットマスク（現在の位置は含まない）
+        """
+        unvisited = ~self.board & ((1 << self.len) - 1)
+        reachable = 0
+        frontier = self.available_positions_map[self.pos] & unvisited
+        while frontier:
+            reachable |= frontier
+            next_frontier = 0
+            while frontier:
+                low = frontier & -frontier
+                frontier ^= low
+                next_frontier |= self.available_positions_map[low.bit_length() - 1]
+            frontier = next_frontier & unvisited & ~reachable
+        return reachable
+
+    def _can_compute_random_play_result(self) -> bool:
+        """現在の状態でプレイアウトの代わりに厳密な勝率を計算するかどうかを判定する
+
+        厳密な勝率は一様ランダムなプレイアウトの期待値なので、random方策の場合にのみ使う。
+        """
+        return (
+            self.playout_policy == "random"
+            and self.get_reachable_mask().bit_count() <= self.exact_threshold
+        )
+
+    def _get_pool(self) -> Pool:
+        """プレイアウト用のワーカープロセスのプールを取得する（なければ作成する）"""
+        if self._pool is None:
+            self._pool = multiprocessing.Pool(
+                self.num_workers, initializer=init_playout_worker, initargs=(self,)
+            )
+        return self._pool
+
+    def count_playout_wins(
+        self, board: int, position: int, current_player: bool, num_playout: int
+    ) -> int:
+        """与えられた状態からプレイアウトを行い、先手が勝った回数を返す
+
+        Args:
+            board (int): 盤面のビット表現
+            position (int): 駒の位置のインデックス
+            current_player (bool): 現在の手番（True: 先手, False: 後手）
+            num_playout (int): プレイアウトの試行回数
+
+        Returns:
+            int: 先手が勝った回数
+        """
+        first_player_wins = 0
+        choose = PLAYOUT_POLICIES[self.playout_policy]
+        moves_map = self.available_positions_map
+        for _ in range(num_playout):
+            # 盤面はローカル変数上で進めるため、ボード状態を戻す必要はない
+            visited, pos = board, position
             player = current_player  # True: 先手, False: 後手
             while True:
-                available_positions = self.get_available_positions()
-                if not available_positions:
+                # 移動可能かつ未訪問の位置のビットマスク
+                moves = ~visited & moves_map[pos]
+                if not moves:
                     if not player:
                         # 後手が動けないなら先手の勝ち
                         first_player_wins += 1
                     break
 
-                # ランダムに移動を選択
-                chosen_position = random.choice(available_positions)
-                self.make_move(chosen_position)
+                # 方策に従って移動を選択
+                pos = choose(self, visited, moves)
+                visited |= 1 << pos
 
                 # プレイヤー交代
                 player = not player
-            # ゲーム終了後、ボード状態を元に戻す
-            self.set_state(current_board, current_pos)
 
-        return first_player_wins / self.num_playout
+        return first_player_wins
 
     def get_canonical_state(self) -> tuple[int, int]:
         """現在の盤面状態の正規形（対称変換の中で最小の値）を返す
@@ -260,15 +624,64 @@ class Board:
 
         return min_pos, min_board
 
-    def get_state_key(self) -> int:
+    def get_state_key(self, record_stats: bool = True) -> int:
         """現在の盤面状態の一意なキーを生成する
 
+        深さがcanonical_max_depth以下か未訪問マス数がcanonical_min_empty以上なら対称変換で正規化し、
+        それ以外は正規化せずにそのままの盤面からキーを作る。
+        正規化しないキーが別の局面の正規化したキーと一致するのは両者が対称な場合だけなので、混在させてよい。
+
+        Args:
+            record_stats (bool): symmetry_statsのときに正規化の統計に記録するかどうか
+
         Returns:
             int: 盤面状態のキー
         """
-        canonical_pos, canonical_board = self.get_canonical_state()
+        visited_count = self.board.bit_count()
+        depth = visited_count - 1
+        record_stats = record_stats and self.symmetry_stats
+        if (
+            depth <= self.canonical_max_depth
+            or self.len - visited_count >= self.canonical_min_empty
+        ):
+            if not record_stats:
+                key_pos, key_board = self.get_canonical_state()
+            else:
+                # 時間の計測と深さごとの集計は統計を表示する場合だけ行う
+                start = time.perf_counter()
+                key_pos, key_board = self.get_canonical_state()
+                self.canonical_times[depth] += time.perf_counter() - start
+                self.canonical_counts[depth] += 1
+                if key_pos != self.pos or key_board != self.board:
+                    self.transformed_counts[depth] += 1
+        else:
+            key_pos, key_board = self.pos, self.board
+            if record_stats:
+                self.raw_key_counts[depth] += 1
+
+        if record_stats:
+            raw_key = (self.pos << 64) | self.board
+            self._last_raw_key_new = raw_key not in self._seen_raw_keys
+            if len(self._seen_raw_keys) >= SEEN_RAW_KEYS_LIMIT:
+                # 記録を空にした後は、既に現れた盤面の置換表のヒットも統合として数えることがある
+                self._seen_raw_keys.clear()
+            self._seen_raw_keys.add(raw_key)
+
         # 駒の位置を上位ビットに、盤面を下位ビットに結合してキーを生成
-        return (canonical_pos << 64) | canonical_board
+        return (key_pos << 64) | key_board
+
+    def clear_seen_raw_keys(self):
+        """統合の判定用に記録した正規化前の盤面を空にする（探索の開始時に呼ぶ）"""
+        self._seen_raw_keys.clear()
+        self._last_raw_key_new = False
+
+    def record_symmetry_merge(self):
+        """直前に作ったキーが置換表にあったことを正規化の統計に記録する
+
+        元の盤面が初めて現れたのに置換表にあった場合は、対称な別の局面の結果を使えたとみなす。
+        """
+        if self._last_raw_key_new:
+            self.symmetry_merges[self.board.bit_count() - 1] += 1
 
     @staticmethod
     def _create_position_index_map(size: tuple[int, int]) -> dict[tuple[int, int], int]:
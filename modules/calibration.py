@@ -0,0 +1,225 @@
+"""葉の静的評価の重みの較正
+
+ランダムに進めた終盤の局面を厳密に解き、静的評価の勝率が結果に合うようにロジスティック回帰で重みを求める。
+結果は駒の種類・ボードサイズごとのプロファイルとしてJSONファイルに書き出し、探索時に読み込む。
+
+厳密に解ける局面に限るため、到達可能なマス数がmax_reachable以下の局面だけを使う。
+探索の葉はこれより大きいことが多いので、較正は外挿になる。
+"""
+
+import argparse
+import json
+import math
+import random
+
+from .board import Board
+from .evaluation import (
+    DEFAULT_STATIC_WEIGHTS,
+    STATIC_FEATURES,
+    static_features,
+)
+from .minimax import (
+    begin_search,
+    clear_transposition_table,
+    minimax,
+    set_transposition_table,
+)
+from .ttable import GenerationalTranspositionTable
+
+# 確率の対数を取る際の下限
+_EPSILON = 1e-9
+
+
+def create_samples(
+    piece_type: str,
+    size: tuple[int, int],
+    num_samples: int,
+    max_reachable: int,
+    rng: random.Random,
+) -> list[tuple[dict[str, float], float]]:
+    """終盤の局面を集めて厳密に解く
+
+    ランダムな初期位置からランダムに手を進め、到達可能なマス数がmax_reachable以下になった後、
+    さらに0から2手ランダムに進めた局面を使う。勝敗が静的に確定する局面は除く。
+
+    Args:
+        piece_type (str): 駒の種類
+        size (tuple[int, int]): ボードのサイズ（縦, 横）
+        num_samples (int): 集める局面数
+        max_reachable (int): 局面の到達可能なマス数の上限
+        rng (random.Random): 乱数生成器
+
+    Returns:
+        list[tuple[dict[str, float], float]]: (特徴量, 手番が勝つなら1・負けるなら0) のリスト
+    """
+    samples: list[tuple[dict[str, float], float]] = []
+    while len(samples) < num_samples:
+        initial_position = (rng.randrange(size[0]), rng.randrange(size[1]))
+        board = Board(size, initial_position, piece_type, 0)
+        extra_moves = rng.randrange(3)
+        while True:
+            available_positions = board.get_available_positions()
+            if not available_positions:
+                break
+            if board.get_reachable_mask().bit_count() <= max_reachable:
+                if extra_moves == 0:
+                    break
+                extra_moves -= 1
+            board.make_move(rng.choice(available_positions))
+
+        features = static_features(board)
+        if isinstance(features, float):
+            continue
+        player = board.get_current_player()
+        # 同じボードの局面を続けて解くので、前の局面で解いた勝敗を引き継ぐ
+        begin_search(board, True)
+        result, _ = minimax(board, 0, player, False, True, board.len + 1, 0.0, 1.0)
+        samples.append((features, result if player else 1.0 - result))
+    clear_transposition_table()
+    return samples
+
+
+def fit_static_weights(
+    samples: list[tuple[dict[str, float], float]],
+    l2: float = 1e-3,
+    iterations: int = 20,
+) -> dict[str, float]:
+    """ニュートン法によるロジスティック回帰で重みを求める
+
+    Args:
+        samples (list[tuple[dict[str, float], float]]): (特徴量, 手番の勝敗) のリスト
+        l2 (float): L2正則化の係数（特徴量が定数になる場合の発散を防ぐ）
+        iterations (int): ニュートン法の反復回数
+
+    Returns:
+        dict[str, float]: 特徴量ごとの重み
+    """
+    n = len(STATIC_FEATURES)
+    rows = [[features[name] for name in STATIC_FEATURES] for features, _ in samples]
+    labels = [label for _, label in samples]
+    w = [0.0] * n
+    for _ in range(iterations):
+        gradient = [l2 * wi for wi in w]
+        hessian = [[l2 if i == j else 0.0 for j in range(n)] for i in range(n)]
+        for x, y in zip(rows, labels):
+            p = 1.0 / (1.0 + math.exp(-max(-30.0, min(30.0, _dot(w, x)))))
+            for i in range(n):
+                gradient[i] += (p - y) * x[i]
+                for j in range(n):
+                    hessian[i][j] += p * (1.0 - p) * x[i] * x[j]
+        step = _solve(hessian, gradient)
+        w = [wi - si for wi, si in zip(w, step)]
+    return {name: round(wi, 4) for name, wi in zip(STATIC_FEATURES, w)}
+
+
+def _dot(a: list[float], b: list[float]) -> float:
+    """ベクトルの内積"""
+    return sum(x * y for x, y in zip(a, b))
+
+
+def _solve(matrix: list[list[float]], vector: list[float]) -> list[float]:
+    """部分ピボット選択付きのガウスの消去法で連立一次方程式を解く
+
+    Args:
+        matrix (list[list[float]]): 係数行列（正則であること）
+        vector (list[float]): 右辺
+
+    Returns:
+        list[float]: 解
+    """
+    n = len(vector)
+    a = [row[:] + [v] for row, v in zip(matrix, vector)]
+    for col in range(n):
+        pivot = max(range(col, n), key=lambda r: abs(a[r][col]))
+        a[col], a[pivot] = a[pivot], a[col]
+        for r in range(col + 1, n):
+            factor = a[r][col] / a[col][col]
+            for c in range(col, n + 1):
+                a[r][c] -= factor * a[col][c]
+    x = [0.0] * n
+    for r in range(n - 1, -1, -1):
+        x[r] = (a[r][n] - _dot(a[r][r + 1 : n], x[r + 1 :])) / a[r][r]
+    return x
+
+
+def score_static_weights(
+    samples: list[tuple[dict[str, float], float]], weights: dict[str, float]
+) -> tuple[float, float]:
+    """重みの較正の良さを評価する
+
+    Args:
+        samples (list[tuple[dict[str, float], float]]): (特徴量, 手番の勝敗) のリスト
+        weights (dict[str, float]): 特徴量ごとの重み
+
+    Returns:
+        tuple[float, float]: (平均対数損失, Brierスコア)
+    """
+    log_loss = 0.0
+    brier = 0.0
+    for features, label in samples:
+        z = sum(weights[name] * value for name, value in features.items())
+        p = min(1.0 - _EPSILON, max(_EPSILON, 1.0 / (1.0 + math.exp(-z))))
+        log_loss -= label * math.log(p) + (1.0 - label) * math.log(1.0 - p)
+        brier += (p - label) ** 2
+    return log_loss / len(samples), brier / len(samples)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="葉の静的評価の重みの較正")
+    parser.add_argument("output", type=str, help="プロファイルの出力先のファイルパス")
+    parser.add_argument(
+        "--pieces",
+        type=str,
+        nargs="+",
+        default=["rook", "king", "queen", "knight"],
+        help="較正する駒の種類",
+    )
+    parser.add_argument(
+        "--sizes",
+        type=str,
+        nargs="+",
+        default=["5x5", "6x6"],
+        help="較正するボードサイズ（縦x横）。最後のサイズの重みを駒の既定値にする",
+    )
+    parser.add_argument("--samples", type=int, default=500, help="局面数")
+    parser.add_argument(
+        "--max-reachable",
+        type=int,
+        default=14,
+        help="厳密に解く局面の到達可能なマス数の上限",
+    )
+    parser.add_argument(
+        "--tt-entries",
+        type=int,
+        default=2_000_000,
+        help="局面を解く間に引き継ぐ置換表の登録数の上限",
+    )
+    parser.add_argument("--seed", type=int, default=0, help="乱数シード")
+    args = parser.parse_args()
+
+    set_transposition_table(GenerationalTranspositionTable(args.tt_entries))
+    rng = random.Random(args.seed)
+    profiles: dict[str, dict[str, dict[str, float]]] = {}
+    for piece_type in args.pieces:
+        profiles[piece_type] = {}
+        weights = None
+        for size_str in args.sizes:
+            height, width = map(int, size_str.split("x"))
+            samples = create_samples(
+                piece_type, (height, width), args.samples, args.max_reachable, rng
+            )
+            # 8割で重みを求め、残りで較正の良さを測る
+            split = len(samples) * 4 // 5
+            weights = fit_static_weights(samples[:split])
+            baseline = score_static_weights(samples[split:], DEFAULT_STATIC_WEIGHTS)
+            fitted = score_static_weights(samples[split:], weights)
+            profiles[piece_type][size_str] = weights
+            print(
+                f"{piece_type} {size_str}: 対数損失 {baseline[0]:.3f} -> {fitted[0]:.3f}, "
+                f"Brier {baseline[1]:.3f} -> {fitted[1]:.3f} {weights}"
+            )
+        if weights is not None:
+            profiles[piece_type]["default"] = weights
+
+    with open(args.output, "w") as f:
+        json.dump(profiles, f, indent=2)
@@ -0,0 +1,303 @@
+"""正準な状態空間の数え上げ（センサス）
+
+現在の状態から到達できる状態を幅優先で列挙し、Board.get_state_keyで同一視した状態（正準な状態）の数を深さごとに数える。
+置換表の大きさや探索の設定を選ぶ目安にするため、あわせて次の値を求める。
+
+- 対称変換で同一視しない状態の数：幅優先の列挙はこの状態で行い、正準な状態の数はそのキーの重複を除いて求める
+- 到達可能性で縮約した状態の数：駒から到達できないマスを訪問済みとみなした状態（勝敗はこれだけで決まる）の正準な状態の数
+  （縮約した状態は深さの情報を持たないので、合計は深さごとの数の和で、異なる深さの同じ状態を重複して数える）
+- 終局の正準な状態（動けない状態）の数
+
+重複の除去は、メモリ上の集合が上限を超えたらキーの順に並べたラン（一時ファイル）に書き出し、
+最後にランを併合して行う。そのため、大きなボードでもメモリは上限とランの数に比例する分しか使わない。
+"""
+
+import argparse
+import heapq
+import os
+import struct
+import sys
+import tempfile
+from collections.abc import Iterable, Iterator
+from typing import NamedTuple
+
+from .board import Board
+
+# ランの1レコード（キーの上位64bit = 駒の位置, キーの下位64bit = 盤面）
+_RECORD = struct.Struct("<QQ")
+_MASK64 = (1 << 64) - 1
+# ランを読み書きする際にまとめて扱うレコード数
+_CHUNK_RECORDS = 4096
+# 併合で同時に開くランの数の上限（超えたらランを1つに併合しておく）
+_MAX_RUNS = 64
+
+
+class CensusLevel(NamedTuple):
+    """1つの深さの数え上げの結果"""
+
+    depth: int  # 現在の状態からの手数
+    canonical: int  # 正準な状態の数
+    raw: int  # 対称変換で同一視しない状態の数
+    reduced: int  # 到達可能性で縮約した正準な状態の数
+    terminal: int  # 終局の正準な状態の数
+
+
+class SortedRunSet:
+    def __init__(self, directory: str, max_memory: int):
+        """メモリの上限を超えたらソート済みのランに書き出すキーの集合を初期化する
+
+        Args:
+            directory (str): ランを書き出すディレクトリ
+            max_memory (int): メモリ上に保持するキーの数の上限
+        """
+        self.directory = directory
+        self.max_memory = max_memory
+        self._memory: set[int] = set()
+        self._runs: list[str] = []
+        self.spilled_runs = 0  # これまでに書き出したランの数
+
+    def add(self, key: int):
+        """キーを加える
+
+        Args:
+            key (int): 状態キー
+        """
+        self._memory.add(key)
+        if len(self._memory) >= self.max_memory:
+            self._spill()
+
+    def _spill(self):
+        """メモリ上のキーをキーの順に並べてランに書き出す"""
+        self._runs.append(self._write_run(sorted(self._memory)))
+        self.spilled_runs += 1
+        self._memory.clear()
+        if len(self._runs) >= _MAX_RUNS:
+            runs, self._runs = self._runs, []
+            self._runs.append(self._write_run(_merge_unique(runs, [])))
+
+    def _write_run(self, keys: Iterable[int]) -> str:
+        """小さい順のキーをランのファイルに書き出し、そのパスを返す"""
+        fd, path = tempfile.mkstemp(dir=self.directory, suffix=".run")
+        with os.fdopen(fd, "wb") as f:
+            chunk: list[bytes] = []
+            for key in keys:
+                chunk.append(_RECORD.pack(key >> 64, key & _MASK64))
+                if len(chunk) >= _CHUNK_RECORDS:
+                    f.write(b"".join(chunk))
+                    chunk.clear()
+            f.write(b"".join(chunk))
+        return path
+
+    def drain(self) -> Iterator[int]:
+        """重複を除いたキーを小さい順に返し、集合を空にする（ランのファイルは読み終えたら削除する）
+
+        Returns:
+            Iterator[int]: 重複を除いたキー
+        """
+        memory = sorted(self._memory)
+        self._memory = set()
+        runs, self._runs = self._runs, []
+        return _merge_unique(runs, memory)
+
+
+def _merge_unique(runs: list[str], memory: list[int]) -> Iterator[int]:
+    """ランとメモリ上の小さい順のキーを併合し、重複を除いて小さい順に返す"""
+    last = None
+    for key in heapq.merge(memory, *(_read_run(path) for path in runs)):
+        if key != last:
+            last = key
+            yield key
+
+
+def _read_run(path: str) -> Iterator[int]:
+    """ランのキーを順に読み、読み終えたらファイルを削除する"""
+    with open(path, "rb") as f:
+        while chunk := f.read(_RECORD.size * _CHUNK_RECORDS):
+            for high, low in _RECORD.iter_unpack(chunk):
+                yield high << 64 | low
+    os.remove(path)
+
+
+def run_census(
+    board: Board, max_depth: int, max_memory: int
+) -> tuple[list[CensusLevel], int]:
+    """現在の状態から到達できる状態を深さごとに数える
+
+    対称変換で同一視しない状態を幅優先で展開し、深さごとに正準なキーでも重複を除いて数える。
+    正準なキーを求めるため、ボードの正規化の方針によらず常に正規化する。
+
+    Args:
+        board (Board): チェスボード（終了時に元の状態と正規化の方針に戻す）
+        max_depth (int): 数える深さの上限（現在の状態からの手数）
+        max_memory (int): 深さごとにメモリ上で重複を除くキーの数の上限（超えたらディスクに書き出す）
+
+    Returns:
+        tuple[list[CensusLevel], int]: (深さごとの結果, 書き出したランの数の合計)
+    """
+    visited, position = board.get_state()
+    canonical_max_depth = board.canonical_max_depth
+    board.canonical_max_depth = board.len
+    all_squares = (1 << board.len) - 1
+    levels: list[CensusLevel] = []
+    spilled_runs = 0
+    with tempfile.TemporaryDirectory(prefix="census-") as directory:
+        # 対称変換で同一視しない状態のキー（駒の位置を上位64bitに、盤面を下位64bitに結合する）
+        frontier = SortedRunSet(directory, max_memory)
+        frontier.add((position << 64) | visited)
+        try:
+            for depth in range(max_depth + 1):
+                children = SortedRunSet(directory, max_memory)
+                canonical = SortedRunSet(directory, max_memory)
+                reduced = SortedRunSet(directory, max_memory)
+                terminal = SortedRunSet(directory, max_memory)
+                raw = 0
+                expand = depth < max_depth
+                for key in frontier.drain():
+                    state_board, state_pos = key & _MASK64, key >> 64
+                    board.set_state(state_board, state_pos)
+                    raw += 1
+                    canonical_key = board.get_state_key()
+                    canonical.add(canonical_key)
+                    moves = board.get_available_positions()
+                    if not moves:
+                        terminal.add(canonical_key)
+                    # 到達できないマスを訪問済みにした状態で、勝敗に関係する部分だけを比べる
+                    board.set_state(
+                        all_squares & ~board.get_reachable_mask(), state_pos
+                    )
+                    reduced.add(board.get_state_key())
+                    if expand:
+                        for move in moves:
+                            children.add((move << 64) | state_board | (1 << move))
+                num_canonical = sum(1 for _ in canonical.drain())
+                num_reduced = sum(1 for _ in reduced.drain())
+                num_terminal = sum(1 for _ in terminal.drain())
+                spilled_runs += sum(
+                    runs.spilled_runs
+                    for runs in (frontier, canonical, reduced, terminal)
+                )
+                if raw == 0:
+                    break
+                levels.append(
+                    CensusLevel(depth, num_canonical, raw, num_reduced, num_terminal)
+                )
+                frontier = children
+            # 最後の深さの子の集合が残っていれば、ランのファイルを消す
+            for _ in frontier.drain():
+                pass
+            spilled_runs += frontier.spilled_runs
+        finally:
+            board.set_state(visited, position)
+            board.canonical_max_depth = canonical_max_depth
+    return levels, spilled_runs
+
+
+def brute_force_census(board: Board, max_depth: int) -> list[CensusLevel]:
+    """すべての手順を辿ってメモリ上の集合で状態を数える（run_censusの確認用）
+
+    Args:
+        board (Board): チェスボード（終了時に元の状態と正規化の方針に戻す）
+        max_depth (int): 数える深さの上限（現在の状態からの手数）
+
+    Returns:
+        list[CensusLevel]: 深さごとの結果
+    """
+    canonical_max_depth = board.canonical_max_depth
+    board.canonical_max_depth = board.len
+    all_squares = (1 << board.len) - 1
+    raw: list[set[tuple[int, int]]] = [set() for _ in range(max_depth + 1)]
+    canonical: list[set[int]] = [set() for _ in range(max_depth + 1)]
+    reduced: list[set[int]] = [set() for _ in range(max_depth + 1)]
+    terminal: list[set[int]] = [set() for _ in range(max_depth + 1)]
+
+    def visit(depth: int):
+        state_board, state_pos = board.get_state()
+        raw[depth].add((state_board, state_pos))
+        key = board.get_state_key()
+        canonical[depth].add(key)
+        moves = board.get_available_positions()
+        if not moves:
+            terminal[depth].add(key)
+        board.set_state(all_squares & ~board.get_reachable_mask(), state_pos)
+        reduced[depth].add(board.get_state_key())
+        board.set_state(state_board, state_pos)
+        if depth < max_depth:
+            for move in moves:
+                original_pos = board.make_move(move)
+                visit(depth + 1)
+                board.undo_move(move, original_pos)
+
+    try:
+        visit(0)
+    finally:
+        board.canonical_max_depth = canonical_max_depth
+    return [
+        CensusLevel(
+            depth,
+            len(canonical[depth]),
+            len(raw[depth]),
+            len(reduced[depth]),
+            len(terminal[depth]),
+        )
+        for depth in range(max_depth + 1)
+        if raw[depth]
+    ]
+
+
+def print_census(levels: list[CensusLevel]):
+    """深さごとの数え上げの結果と、対称変換・到達可能性による削減率を表示する
+
+    Args:
+        levels (list[CensusLevel]): 深さごとの結果
+    """
+    print("深さ 正準な状態 対称変換なし 対称の削減率 到達性で縮約 到達性の削減率 終局")
+    for level in levels:
+        print(
+            f"{level.depth:>4} {level.canonical:>12,} {level.raw:>12,} "
+            f"{level.raw / level.canonical:>8.2f}x {level.reduced:>12,} "
+            f"{level.canonical / level.reduced:>8.2f}x {level.terminal:>10,}"
+        )
+    canonical = sum(level.canonical for level in levels)
+    raw = sum(level.raw for level in levels)
+    reduced = sum(level.reduced for level in levels)
+    terminal = sum(level.terminal for level in levels)
+    print(
+        f"合計 {canonical:>12,} {raw:>12,} {raw / canonical:>8.2f}x "
+        f"{reduced:>12,} {canonical / reduced:>8.2f}x {terminal:>10,}"
+    )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description="小さいボードでの数え上げと、すべての手順を辿った数え上げとの照合"
+    )
+    parser.add_argument(
+        "--max-memory",
+        type=int,
+        default=64,
+        help="メモリ上で重複を除くキーの数の上限（小さくしてディスクへの書き出しも確かめる）",
+    )
+    args = parser.parse_args()
+
+    # (駒の種類, ボードのサイズ, 初期位置, 深さ)
+    checks = [
+        ("king", (4, 4), (0, 0), 8),
+        ("rook", (3, 4), (1, 1), 8),
+        ("queen", (3, 3), (1, 1), 8),
+        ("knight", (4, 4), (0, 1), 10),
+    ]
+    mismatches = 0
+    for piece_type, size, position, depth in checks:
+        board = Board(size, position, piece_type, 0)
+        levels, _ = run_census(board, depth, args.max_memory)
+        expected = brute_force_census(board, depth)
+        status = "一致" if levels == expected else "不一致"
+        mismatches += levels != expected
+        print(
+            f"{piece_type:<7} {size[0]}x{size[1]} {position!s:>8} {depth:>4} "
+            f"{sum(level.raw for level in levels):>10,} {status}"
+        )
+    if mismatches:
+        print(f"{mismatches}件の数え上げがすべての手順を辿った結果と一致しませんでした")
+        sys.exit(1)
+    print("すべての数え上げがすべての手順を辿った結果と一致しました")
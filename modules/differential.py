@@ -0,0 +1,375 @@
+"""探索エンジンとキャッシュの設定の差分テスト
+
+ランダムなボードサイズ・駒・途中の状態を作り、すべてのエンジンとキャッシュの設定で厳密に解いて、
+勝敗が網羅的な列挙（枝刈りも正規化もしない探索）の結果と一致することを確かめる。
+あわせて設定ごとの探索時間の合計と、基準の設定に対する速さの比を表示する。
+
+また、各局面の残余グラフの正準なキーが頂点の番号の付け替えで変わらないことも確かめる。
+
+勝敗やキーが1つでも一致しなければ終了コード1で終わるので、高速化の変更を入れる前の確認に使える。
+"""
+
+import argparse
+import os
+import random
+import sys
+import tempfile
+import time
+from collections.abc import Callable
+from typing import NamedTuple
+
+from .board import Board
+from .minimax import (
+    begin_search,
+    minimax,
+    minimax_batched,
+    set_bipartite_solver,
+    set_residual_cache,
+    set_transposition_table,
+)
+from .parity import BipartiteSolver
+from .residual import ResidualCache, canonical_key, extract_residual_graph
+from .tds import solve_sharded
+from .ttable import (
+    CompactTranspositionTable,
+    GenerationalTranspositionTable,
+    MainTable,
+    SpillingTranspositionTable,
+    TwoLevelTranspositionTable,
+)
+
+PIECE_TYPES = ["rook", "king", "queen", "knight"]
+RESIDUAL_TABLE_PATH = os.path.join(os.path.dirname(__file__), "residual_table.json")
+
+
+class EngineConfig(NamedTuple):
+    """差分テストで比べるエンジンとキャッシュの設定"""
+
+    heuristic: bool = True
+    board_options: dict | None = None  # Boardのキーワード引数
+    compact_tt: bool = False
+    residual_vertices: int = 0  # 0なら残余グラフのキャッシュを使わない
+    residual_table: bool = False
+    batch_size: int = 0
+    bipartite: bool = False  # 二部グラフのソルバーを使うかどうか
+    tds_workers: int = 0  # 置換表を分割するワーカー数（0なら分割しない）
+    spill_entries: int = 0  # ディスクへ書き出す表のメモリの層の登録数（0なら不使用）
+    l1_entries: int = 0  # 置換表の前に置くL1のスロット数（0なら置かない）
+    tt_entries: int = 0  # 世代付きの置換表の登録数の上限（0なら使わない）
+
+
+# 設定の名前 -> 設定（最初の設定を速さの比の基準にする）
+ENGINE_CONFIGS: dict[str, EngineConfig] = {
+    "heuristic": EngineConfig(),
+    "plain": EngineConfig(heuristic=False),
+    "raw-keys": EngineConfig(board_options={"canonical_max_depth": -1}),
+    "selective": EngineConfig(board_options={"canonical_max_depth": 4}),
+    "min-empty": EngineConfig(
+        board_options={"canonical_max_depth": -1, "canonical_min_empty": 8}
+    ),
+    "compact-tt": EngineConfig(compact_tt=True),
+    "residual": EngineConfig(residual_vertices=10),
+    "residual-table": EngineConfig(residual_vertices=10, residual_table=True),
+    "batched": EngineConfig(batch_size=16),
+    "bipartite": EngineConfig(bipartite=True),
+    "tds": EngineConfig(tds_workers=3),
+    "tds-l1": EngineConfig(tds_workers=3, l1_entries=64),
+    "spill": EngineConfig(spill_entries=64),
+    "l1": EngineConfig(l1_entries=64),
+    "l1-compact-tt": EngineConfig(compact_tt=True, l1_entries=64),
+    "generational": EngineConfig(tt_entries=64),
+}
+
+
+class TestCase(NamedTuple):
+    """差分テストの局面"""
+
+    size: tuple[int, int]
+    piece_type: str
+    state: str  # Board.encode_stateの形式
+
+
+def create_cases(
+    num_cases: int,
+    max_size: int,
+    max_reachable: int,
+    rng: random.Random,
+    piece_types: list[str] = PIECE_TYPES,
+) -> list[TestCase]:
+    """ランダムな局面を作る
+
+    ボードサイズと駒と初期位置をランダムに選び、到達可能なマス数がmax_reachable以下になるまで手をランダムに進める。
+
+    Args:
+        num_cases (int): 局面数
+        max_size (int): ボードの縦と横のサイズの上限
+        max_reachable (int): 到達可能なマス数の上限（網羅的な列挙の手間を抑える）
+        rng (random.Random): 乱数生成器
+        piece_types (list[str]): 選ぶ駒の種類
+
+    Returns:
+        list[TestCase]: 局面のリスト
+    """
+    cases: list[TestCase] = []
+    for _ in range(num_cases):
+        size = (rng.randint(1, max_size), rng.randint(2, max_size))
+        piece_type = rng.choice(piece_types)
+        board = Board(
+            size,
+            (rng.randrange(size[0]), rng.randrange(size[1])),
+            piece_type,
+            0,
+        )
+        # 到達可能なマス数が上限以下になってから、さらに0から2手進める
+        extra_moves = rng.randrange(3)
+        while available_positions := board.get_available_positions():
+            if board.get_reachable_mask().bit_count() <= max_reachable:
+                if extra_moves == 0:
+                    break
+                extra_moves -= 1
+            board.make_move(rng.choice(available_positions))
+        cases.append(TestCase(size, piece_type, board.encode_state()))
+    return cases
+
+
+def enumerate_result(board: Board) -> bool:
+    """網羅的な列挙で手番が勝つかどうかを求める（オラクル）
+
+    枝刈りも対称変換も使わず、正規化しない盤面そのものでメモ化して、すべての手順を調べる。
+
+    Args:
+        board (Board): チェスボード
+
+    Returns:
+        bool: 手番が勝つならTrue
+    """
+    moves_map = board.available_positions_map
+    memo: dict[tuple[int, int], bool] = {}
+
+    def wins(visited: int, position: int) -> bool:
+        key = (visited, position)
+        if key not in memo:
+            moves = moves_map[position] & ~visited
+            result = False
+            while moves:
+                low = moves & -moves
+                moves ^= low
+                if not wins(visited | low, low.bit_length() - 1):
+                    result = True
+            memo[key] = result
+        return memo[key]
+
+    return wins(board.board, board.pos)
+
+
+def check_residual_keys(
+    cases: list[TestCase], rng: random.Random, permutations: int = 4
+) -> int:
+    """各局面の残余グラフの正準なキーが、駒以外の頂点の番号の付け替えで変わらないかを調べる
+
+    Args:
+        cases (list[TestCase]): 局面のリスト
+        rng (random.Random): 乱数生成器
+        permutations (int): 局面ごとに試す付け替えの数
+
+    Returns:
+        int: 隣接が対称でない、またはキーが変わった局面の数
+    """
+    mismatches = 0
+    for case in cases:
+        board = Board(case.size, (0, 0), case.piece_type, 0)
+        board.set_state(*board.decode_state(case.state))
+        adj = extract_residual_graph(board)
+        n = len(adj)
+        symmetric = all(
+            ((adj[u] >> v) & 1) == ((adj[v] >> u) & 1)
+            for u in range(n)
+            for v in range(n)
+        )
+        key = canonical_key(adj)
+        consistent = True
+        for _ in range(permutations):
+            # 頂点0（駒の位置）は固定して、残りの頂点の番号を入れ替える
+            order = list(range(1, n))
+            rng.shuffle(order)
+            new_index = [0] * n
+            for v, u in enumerate(order, start=1):
+                new_index[u] = v
+            permuted = [0] * n
+            for u in range(n):
+                for v in range(n):
+                    if (adj[u] >> v) & 1:
+                        permuted[new_index[u]] |= 1 << new_index[v]
+            permuted_key = canonical_key(permuted)
+            # 正準なラベル付けの探索が上限を超えた場合は比べられない
+            if key is not None and permuted_key is not None and permuted_key != key:
+                consistent = False
+        if not symmetric or not consistent:
+            mismatches += 1
+    return mismatches
+
+
+def run_engine(case: TestCase, config: EngineConfig) -> tuple[float, int, float]:
+    """設定に従って局面を厳密に解く
+
+    Args:
+        case (TestCase): 局面
+        config (EngineConfig): エンジンとキャッシュの設定
+
+    Returns:
+        tuple[float, int, float]: (先手の勝利確率, 探索した局面数, 探索時間（秒）)
+    """
+    board = Board(case.size, (0, 0), case.piece_type, 0, **(config.board_options or {}))
+    board.set_state(*board.decode_state(case.state))
+    player = board.get_current_player()
+    max_depth = board.len + 1
+
+    table: MainTable = {}
+    if config.compact_tt:
+        table = CompactTranspositionTable(1.0)
+    elif config.spill_entries > 0:
+        # 表は既存のファイルを使わないので、空のディレクトリにファイルを作らせる
+        spill_path = os.path.join(tempfile.mkdtemp(), "table.tt")
+        table = SpillingTranspositionTable(config.spill_entries, spill_path)
+    elif config.tt_entries > 0:
+        # 登録数を小さくして、探索中に追い出しが起きるようにする
+        table = GenerationalTranspositionTable(config.tt_entries)
+    if config.l1_entries > 0:
+        set_transposition_table(TwoLevelTranspositionTable(table, config.l1_entries))
+    else:
+        set_transposition_table(table)
+    begin_search(board, True)
+    residual_cache = None
+    if config.residual_vertices > 0:
+        residual_cache = ResidualCache(config.residual_vertices)
+        if config.residual_table:
+            residual_cache.load(RESIDUAL_TABLE_PATH)
+    set_residual_cache(residual_cache)
+    set_bipartite_solver(BipartiteSolver() if config.bipartite else None)
+
+    start = time.perf_counter()
+    try:
+        if config.tds_workers > 0:
+            mover_wins, stats = solve_sharded(
+                board, config.tds_workers, config.l1_entries
+            )
+            result = 1.0 if mover_wins == player else 0.0
+            nodes = sum(shard.expanded for shard in stats)
+        elif config.batch_size > 0:
+            result, nodes = minimax_batched(
+                board, player, config.heuristic, max_depth, config.batch_size
+            )
+        else:
+            result, nodes = minimax(
+                board, 0, player, False, config.heuristic, max_depth, 0.0, 1.0
+            )
+    finally:
+        set_transposition_table({})
+        if isinstance(table, SpillingTranspositionTable):
+            table.close()
+            os.rmdir(os.path.dirname(table.path))
+        set_residual_cache(None)
+        set_bipartite_solver(None)
+    return result, nodes, time.perf_counter() - start
+
+
+def run_differential(
+    cases: list[TestCase],
+    configs: dict[str, EngineConfig],
+    on_mismatch: Callable[[TestCase, str, float, bool], None] | None = None,
+) -> tuple[int, dict[str, tuple[float, int]]]:
+    """すべての局面をすべての設定で解き、オラクルとの不一致を数える
+
+    Args:
+        cases (list[TestCase]): 局面のリスト
+        configs (dict[str, EngineConfig]): 設定の名前 -> 設定
+        on_mismatch (Callable | None): 不一致のたびに (局面, 設定の名前, 先手の勝利確率, 手番が勝つか) で呼ぶ関数
+
+    Returns:
+        tuple[int, dict[str, tuple[float, int]]]: (不一致の数, 設定の名前 -> (探索時間の合計, 局面数の合計))
+    """
+    mismatches = 0
+    totals = {name: (0.0, 0) for name in configs}
+    for case in cases:
+        board = Board(case.size, (0, 0), case.piece_type, 0)
+        board.set_state(*board.decode_state(case.state))
+        mover_wins = enumerate_result(board)
+        player = board.get_current_player()
+        expected = 1.0 if mover_wins == player else 0.0
+        for name, config in configs.items():
+            result, nodes, seconds = run_engine(case, config)
+            totals[name] = (totals[name][0] + seconds, totals[name][1] + nodes)
+            if result != expected:
+                mismatches += 1
+                if on_mismatch is not None:
+                    on_mismatch(case, name, result, mover_wins)
+    return mismatches, totals
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description="探索エンジンとキャッシュの設定の差分テスト"
+    )
+    parser.add_argument("--cases", type=int, default=200, help="局面数")
+    parser.add_argument(
+        "--max-size", type=int, default=5, help="ボードの縦と横のサイズの上限"
+    )
+    parser.add_argument(
+        "--max-reachable",
+        type=int,
+        default=14,
+        help="局面の到達可能なマス数の上限",
+    )
+    parser.add_argument(
+        "--configs",
+        type=str,
+        nargs="+",
+        choices=list(ENGINE_CONFIGS),
+        default=list(ENGINE_CONFIGS),
+        help="比べる設定（最初の設定を速さの比の基準にする）",
+    )
+    parser.add_argument(
+        "--pieces",
+        type=str,
+        nargs="+",
+        choices=PIECE_TYPES,
+        default=PIECE_TYPES,
+        help="局面に使う駒の種類",
+    )
+    parser.add_argument("--seed", type=int, default=0, help="乱数シード")
+    args = parser.parse_args()
+
+    def report_mismatch(case: TestCase, name: str, result: float, mover_wins: bool):
+        print(
+            f"不一致: {name} {case.size[0]}x{case.size[1]} {case.piece_type} "
+            f"{case.state} 結果 {result} (手番の{'勝ち' if mover_wins else '負け'}が正解)"
+        )
+
+    cases = create_cases(
+        args.cases,
+        args.max_size,
+        args.max_reachable,
+        random.Random(args.seed),
+        args.pieces,
+    )
+    configs = {name: ENGINE_CONFIGS[name] for name in args.configs}
+    mismatches, totals = run_differential(cases, configs, report_mismatch)
+    key_mismatches = check_residual_keys(cases, random.Random(args.seed))
+
+    base_seconds = totals[args.configs[0]][0]
+    print(f"局面数: {len(cases)}")
+    print("設定                 時間        局面数     局面/秒   基準比")
+    for name, (seconds, nodes) in totals.items():
+        print(
+            f"{name:16s} {seconds:8.3f}秒 {nodes:12,d} {nodes / seconds:11,.0f} "
+            f"{base_seconds / seconds:7.2f}x"
+        )
+    if key_mismatches:
+        print(
+            f"残余グラフのキーが頂点の番号の付け替えで変わった局面: {key_mismatches}件"
+        )
+    if mismatches:
+        print(f"不一致: {mismatches}件")
+    if mismatches or key_mismatches:
+        sys.exit(1)
+    print("すべての設定の勝敗がオラクルと一致しました")
@@ -0,0 +1,226 @@
+"""探索にかかる局面数と時間の事前見積もり
+
+実際の探索（Alpha-Beta枝刈りと置換表を含む）を予算の範囲で途中まで行い、
+深さごとの子の数、枝刈りで探索した子の割合、置換表などで展開を省いた割合を測る。
+その後、Knuthの方法と同じくルートから一様ランダムに手を選んで終局まで進む試行を繰り返し、
+各深さの実際の子の数に測った割合を掛けて重みを積み上げ、重みの合計を1回の試行の局面数の推定値とする。
+
+推定値の平均を見積もりとし、平均 ± z·σ/√n（σは推定値の標本標準偏差、nは試行回数）を信頼区間とする。
+"""
+
+import math
+import random
+import time
+from typing import NamedTuple
+
+from .board import Board
+from .minimax import (
+    SearchAborted,
+    SearchProgress,
+    clear_transposition_table,
+    minimax,
+    set_search_progress,
+)
+
+# ランダムな試行の回数と乱数の種（同じ局面なら同じ見積もりになるように固定する）
+NUM_PROBES = 1000
+PROBE_SEED = 0
+# 信頼区間の幅を決める標準正規分布の分位点（95%）
+CONFIDENCE_Z = 1.96
+
+
+class SearchEstimate(NamedTuple):
+    """探索の見積もり結果
+
+    下限・上限は、ランダムな試行による推定値の平均の信頼区間（既定で95%）である。
+    探索が予算内に終わった場合は、実際の値がそのまま入る。
+    """
+
+    nodes: float
+    nodes_low: float
+    nodes_high: float
+    seconds: float
+    seconds_low: float
+    seconds_high: float
+    progress: float
+    completed: bool
+
+
+def estimate_search(
+    board: Board,
+    heuristic: bool,
+    max_depth: int,
+    node_budget: int | None,
+    time_budget: float | None,
+    batch_size: int = 0,
+    num_probes: int = NUM_PROBES,
+) -> SearchEstimate:
+    """探索局面数と探索時間を見積もる
+
+    Args:
+        board (Board): 探索を始めるチェスボードの状態
+        heuristic (bool): 移動順序の最適化を行うかどうか
+        max_depth (int): 探索の最大深さ
+        node_budget (int | None): 見積もりのために探索する局面数の上限
+        time_budget (float | None): 見積もりのために探索する時間の上限（秒）
+        batch_size (int): 葉をまとめて評価する探索（minimax_batched）の場合はその数（0なら通常の探索）
+        num_probes (int): ルートから終局までのランダムな試行の回数
+
+    Returns:
+        SearchEstimate: 見積もり結果
+    """
+    root_board, root_pos = board.get_state()
+    progress = SearchProgress(node_budget, time_budget)
+    clear_transposition_table()
+    set_search_progress(progress)
+    try:
+        player = board.get_current_player()
+        minimax(board, 0, player, False, heuristic, max_depth, 0.0, 1.0)
+        completed = True
+    except SearchAborted:
+        completed = False
+    finally:
+        set_search_progress(None)
+        board.set_state(root_board, root_pos)
+        clear_transposition_table()
+    elapsed = time.perf_counter() - progress.start
+
+    if (completed and batch_size == 0) or progress.done <= 0.0:
+        # 予算内に終わったか、進捗が測れなかった場合は測った値をそのまま返す
+        return SearchEstimate(
+            progress.nodes,
+            progress.nodes,
+            progress.nodes,
+            elapsed,
+            elapsed,
+            elapsed,
+            progress.done,
+            completed,
+        )
+
+    rng = random.Random(PROBE_SEED)
+    samples = [
+        _probe_nodes(board, progress, max_depth, batch_size > 0, rng)
+        for _ in range(num_probes)
+    ]
+    nodes = sum(samples) / len(samples)
+    # 推定値の標本標準偏差から平均の標準誤差を求める
+    variance = sum((sample - nodes) ** 2 for sample in samples) / max(
+        1, len(samples) - 1
+    )
+    margin = CONFIDENCE_Z * math.sqrt(variance / len(samples))
+    # 探索済みの局面数より少なくなることはない
+    low = max(float(progress.nodes), nodes - margin)
+    high = max(low, nodes + margin)
+    # 探索済みの局面あたりの時間で全体の時間を見積もる（葉をまとめて評価する場合は多めになる）
+    seconds_per_node = elapsed / progress.nodes
+    return SearchEstimate(
+        nodes,
+        low,
+        high,
+        nodes * seconds_per_node,
+        low * seconds_per_node,
+        high * seconds_per_node,
+        progress.done,
+        completed,
+    )
+
+
+def _probe_nodes(
+    board: Board,
+    progress: SearchProgress,
+    max_depth: int,
+    batched: bool,
+    rng: random.Random,
+) -> float:
+    """ルートから一様ランダムに手を選んで進み、探索局面数を1回推定する
+
+    深さdの局面の重みに、その局面の実際の子の数、深さdで探索した子の割合、
+    深さdで展開した局面の割合を掛けたものを深さd+1の重みとし、通った局面の重みを合計する。
+    葉をまとめて評価する探索ではルートの子と葉の直前の局面の子をすべて探索するので、その割合は1とする。
+
+    Args:
+        board (Board): 探索を始めるチェスボードの状態（終わると元に戻す）
+        progress (SearchProgress): 途中まで行った探索の進捗
+        max_depth (int): 探索の最大深さ
+        batched (bool): 葉をまとめて評価する探索かどうか
+        rng (random.Random): 手を選ぶ乱数生成器
+
+    Returns:
+        float: 探索局面数の推定値
+    """
+    root_board, root_pos = board.get_state()
+    total = 0.0
+    weight = 1.0
+    for depth in range(max_depth + 1):
+        total += weight
+        available_positions = board.get_available_positions()
+        if depth >= max_depth or not available_positions:
+            break
+        _, searched_ratio = _child_statistics(progress, depth)
+        if batched and (depth == 0 or depth + 1 >= max_depth):
+            searched_ratio = 1.0
+        weight *= (
+            len(available_positions) * searched_ratio * _expanded_ratio(progress, depth)
+        )
+        board.make_move(rng.choice(available_positions))
+    board.set_state(root_board, root_pos)
+    return total
+
+
+def _expanded_ratio(progress: SearchProgress, depth: int) -> float:
+    """深さごとの、子のある局面のうち置換表などで省かずに子を展開した割合を返す
+
+    その深さで測れていなければ、手番が同じ（偶奇が同じ）より深い深さの値を使う。
+
+    Args:
+        progress (SearchProgress): 探索の進捗
+        depth (int): 深さ
+
+    Returns:
+        float: 子を展開した割合
+    """
+    num_depths = min(len(progress.expanded_counts), len(progress.shortcut_counts))
+    for d in [*range(depth, num_depths, 2), *range(depth + 1, num_depths, 2)]:
+        expanded = progress.expanded_counts[d]
+        if expanded:
+            return expanded / (expanded + progress.shortcut_counts[d])
+    return 1.0
+
+
+def _child_statistics(progress: SearchProgress, depth: int) -> tuple[float, float]:
+    """深さごとの平均の子の数と、そのうち探索した子の割合を返す
+
+    その深さで測れていなければ、手番が同じ（偶奇が同じ）より深い深さの値を使う。
+    勝ちの局面は最初の勝ち手で枝刈りされるため、手番によって割合が大きく異なる。
+
+    Args:
+        progress (SearchProgress): 探索の進捗
+        depth (int): 深さ
+
+    Returns:
+        tuple[float, float]: (平均の子の数, 探索した子の割合)
+    """
+    num_depths = len(progress.expanded_counts)
+    for d in [*range(depth, num_depths, 2), *range(depth + 1, num_depths, 2)]:
+        if progress.expanded_counts[d]:
+            return (
+                progress.child_slots[d] / progress.expanded_counts[d],
+                progress.child_searched[d] / progress.child_slots[d],
+            )
+    return 1.0, 1.0
+
+
+def format_seconds(seconds: float) -> str:
+    """秒数を読みやすい単位の文字列にする
+
+    Args:
+        seconds (float): 秒数
+
+    Returns:
+        str: 単位付きの文字列
+    """
+    for unit, length in [("年", 31536000), ("日", 86400), ("時間", 3600), ("分", 60)]:
+        if seconds >= length:
+            return f"{seconds / length:.1f}{unit}"
+    return f"{seconds:.2f}秒"
@@ -0,0 +1,164 @@
+"""葉の局面の静的評価
+
+プレイアウトの代わりに、ビットボードから安価に求まる特徴量の重み付き和をロジスティック関数で勝率にする。
+重みはmodules/calibration.pyで終盤の局面を厳密に解いた結果に合わせて較正し、
+駒の種類・ボードサイズごとのプロファイルとしてJSONファイルから読み込む。
+
+特徴量はすべて手番の側から見た値である。
+
+- bias: 定数項
+- parity: 到達可能なマス数が奇数なら1、偶数なら-1（すべて辿れるなら奇数で手番の勝ち）
+- reachable: 到達可能なマス数の盤面のマス数に対する割合
+- mobility: 手番の合法手の数（8で割る）
+- onward: 各合法手の後に相手が動ける手の数の最小値（8で割る）
+- color_parity: 移動グラフが二部グラフの場合、色ごとの到達可能なマス数から決まる残りの手数の上限が
+  奇数なら1、偶数なら-1（二部グラフでなければ0）
+"""
+
+import json
+import math
+from typing import TYPE_CHECKING
+
+if TYPE_CHECKING:
+    from .board import Board
+
+STATIC_FEATURES = ["bias", "parity", "reachable", "mobility", "onward", "color_parity"]
+
+# 重みの既定値（較正していない駒とボードサイズに使う）
+DEFAULT_STATIC_WEIGHTS = {
+    "bias": 0.0,
+    "parity": 1.0,
+    "reachable": 0.0,
+    "mobility": 0.0,
+    "onward": -1.0,
+    "color_parity": 0.5,
+}
+
+
+def bipartite_color_mask(moves_map: list[int]) -> int | None:
+    """移動グラフを幅優先探索で2色に塗り、一方の色のマスのビットマスクを返す
+
+    Args:
+        moves_map (list[int]): 各位置から移動可能な位置のビットマスクのリスト
+
+    Returns:
+        int | None: 色0のマスのビットマスク（二部グラフでなければNone）
+    """
+    color: list[int | None] = [None] * len(moves_map)
+    for start in range(len(moves_map)):
+        if color[start] is not None:
+            continue
+        color[start] = 0
+        queue = [start]
+        while queue:
+            v = queue.pop()
+            neighbors = moves_map[v]
+            while neighbors:
+                low = neighbors & -neighbors
+                neighbors ^= low
+                u = low.bit_length() - 1
+                if color[u] is None:
+                    color[u] = 1 - color[v]  # type: ignore[operator]
+                    queue.append(u)
+                elif color[u] == color[v]:
+                    return None
+    return sum(1 << i for i, c in enumerate(color) if c == 0)
+
+
+def static_features(board: "Board") -> dict[str, float] | float:
+    """現在の状態の特徴量を求める
+
+    合法手がない局面と、相手が動けなくなる手がある局面は勝敗が確定しているので、手番の勝率を返す。
+
+    Args:
+        board (Board): チェスボード
+
+    Returns:
+        dict[str, float] | float: 特徴量の辞書、または勝敗が確定している場合の手番の勝率
+    """
+    moves_map = board.available_positions_map
+    visited = board.board
+    moves = moves_map[board.pos] & ~visited
+    if not moves:
+        return 0.0
+
+    min_onward = board.len
+    rest = moves
+    while rest:
+        low = rest & -rest
+        rest ^= low
+        onward = (moves_map[low.bit_length() - 1] & ~(visited | low)).bit_count()
+        if onward == 0:
+            # 相手が動けなくなる手がある
+            return 1.0
+        min_onward = min(min_onward, onward)
+
+    reachable = board.get_reachable_mask()
+    num_reachable = reachable.bit_count()
+    color_parity = 0.0
+    if board.color_mask is not None:
+        # 手番の駒と異なる色のマスから交互に辿るので、手数の上限は少ない方の色の数で決まる
+        color0 = (reachable & board.color_mask).bit_count()
+        if (board.color_mask >> board.pos) & 1:
+            same, other = color0, num_reachable - color0
+        else:
+            same, other = num_reachable - color0, color0
+        max_moves = 2 * min(other, same) + (1 if other > same else 0)
+        color_parity = 1.0 if max_moves % 2 == 1 else -1.0
+
+    return {
+        "bias": 1.0,
+        "parity": 1.0 if num_reachable % 2 == 1 else -1.0,
+        "reachable": num_reachable / board.len,
+        "mobility": moves.bit_count() / 8,
+        "onward": min_onward / 8,
+        "color_parity": color_parity,
+    }
+
+
+def static_win_probability(board: "Board", weights: dict[str, float]) -> float:
+    """現在の状態での手番の勝率を静的評価で求める
+
+    Args:
+        board (Board): チェスボード
+        weights (dict[str, float]): 特徴量ごとの重み
+
+    Returns:
+        float: 手番の勝率
+    """
+    features = static_features(board)
+    if isinstance(features, float):
+        return features
+    return _sigmoid(sum(weights[name] * value for name, value in features.items()))
+
+
+def _sigmoid(x: float) -> float:
+    """ロジスティック関数"""
+    if x >= 0:
+        return 1.0 / (1.0 + math.exp(-x))
+    z = math.exp(x)
+    return z / (1.0 + z)
+
+
+def load_static_weights(
+    path: str, piece_type: str, size: tuple[int, int]
+) -> dict[str, float]:
+    """プロファイルのファイルから駒の種類とボードサイズに合う静的評価の重みを読み込む
+
+    ボードサイズごとの重みがなければ駒の種類の"default"を、それもなければ既定値を返す。
+
+    Args:
+        path (str): プロファイルのファイルパス
+        piece_type (str): 駒の種類
+        size (tuple[int, int]): ボードのサイズ（縦, 横）
+
+    Returns:
+        dict[str, float]: 特徴量ごとの重み
+    """
+    with open(path) as f:
+        profiles = json.load(f)
+    piece_profiles = profiles.get(piece_type, {})
+    weights = piece_profiles.get(
+        f"{size[0]}x{size[1]}", piece_profiles.get("default", {})
+    )
+    return DEFAULT_STATIC_WEIGHTS | weights
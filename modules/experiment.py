@@ -0,0 +1,341 @@
+"""近似探索の精度とコストの実験
+
+厳密な結果が分かっている局面の集合に対して、max_depth・num_playout・プレイアウト方策（と静的評価）の
+組み合わせごとに近似探索を行い、時間・探索局面数・判定の正解率を記録してパレート最適な設定を求める。
+
+各局面では、子局面ごとに近似探索を行って最善の手を選ぶ。
+選んだ手が厳密に最善の手のいずれかなら手の正解、最善の子局面の値の勝敗が厳密な勝敗と一致すれば勝敗の正解とする。
+"""
+
+import argparse
+import csv
+import itertools
+import json
+import os
+import random
+import time
+from typing import NamedTuple
+
+from .board import Board
+from .evaluation import load_static_weights
+from .minimax import (
+    begin_search,
+    clear_transposition_table,
+    minimax,
+    set_transposition_table,
+)
+from .ttable import GenerationalTranspositionTable
+
+STATIC_WEIGHTS_PATH = os.path.join(os.path.dirname(__file__), "static_weights.json")
+
+
+class CorpusEntry(NamedTuple):
+    """厳密な結果が分かっている局面"""
+
+    state: str  # Board.encode_stateの形式
+    win: bool  # 手番が勝つかどうか
+    best_moves: list[int]  # 厳密に最善の手（移動先の位置インデックス）
+
+
+class ExperimentResult(NamedTuple):
+    """1つの設定での実験結果"""
+
+    max_depth: int
+    num_playout: int
+    leaf_eval: str  # プレイアウト方策の名前か"static"
+    seconds: float
+    nodes: int
+    win_accuracy: float
+    move_accuracy: float
+
+
+def create_corpus(
+    piece_type: str,
+    size: tuple[int, int],
+    num_positions: int,
+    max_reachable: int,
+    rng: random.Random,
+) -> list[CorpusEntry]:
+    """局面を集めて厳密に解く
+
+    ランダムな初期位置からランダムに手を進め、到達可能なマス数がmax_reachable以下になった局面を使う。
+    合法手が1つ以下の局面は手の選択がないので除く。
+
+    Args:
+        piece_type (str): 駒の種類
+        size (tuple[int, int]): ボードのサイズ（縦, 横）
+        num_positions (int): 集める局面数
+        max_reachable (int): 局面の到達可能なマス数の上限
+        rng (random.Random): 乱数生成器
+
+    Returns:
+        list[CorpusEntry]: 局面のリスト
+    """
+    corpus: list[CorpusEntry] = []
+    while len(corpus) < num_positions:
+        initial_position = (rng.randrange(size[0]), rng.randrange(size[1]))
+        board = Board(size, initial_position, piece_type, 0)
+        available_positions = board.get_available_positions()
+        while available_positions:
+            if board.get_reachable_mask().bit_count() <= max_reachable:
+                break
+            board.make_move(rng.choice(available_positions))
+            available_positions = board.get_available_positions()
+        if len(available_positions) < 2:
+            continue
+
+        player = board.get_current_player()
+        # 同じボードの局面を続けて解くので、前の局面で解いた勝敗を引き継ぐ
+        begin_search(board, True)
+        child_values = _search_children(board, player, board.len + 1, False)[0]
+        best = max(child_values.values()) if player else min(child_values.values())
+        corpus.append(
+            CorpusEntry(
+                board.encode_state(),
+                best == (1.0 if player else 0.0),
+                [move for move, value in child_values.items() if value == best],
+            )
+        )
+    clear_transposition_table()
+    return corpus
+
+
+def _search_children(
+    board: Board, player: bool, max_depth: int, heuristic: bool
+) -> tuple[dict[int, float], int]:
+    """各子局面を探索する
+
+    Args:
+        board (Board): 親局面のチェスボード（探索後に元の状態に戻す）
+        player (bool): 親局面の手番（True: 先手, False: 後手）
+        max_depth (int): 親局面から数えた探索の最大深さ
+        heuristic (bool): 移動順序の最適化を行うかどうか
+
+    Returns:
+        tuple[dict[int, float], int]: (手 -> 子局面の先手の勝利確率, 探索した局面数)
+    """
+    child_values: dict[int, float] = {}
+    node_count = 0
+    for move in board.get_available_positions():
+        original_pos = board.make_move(move)
+        value, nodes = minimax(
+            board, 1, not player, False, heuristic, max_depth, 0.0, 1.0
+        )
+        board.undo_move(move, original_pos)
+        child_values[move] = value
+        node_count += nodes
+    return child_values, node_count
+
+
+def run_experiment(
+    piece_type: str,
+    size: tuple[int, int],
+    corpus: list[CorpusEntry],
+    max_depth: int,
+    num_playout: int,
+    leaf_eval: str,
+    seed: int | None,
+) -> ExperimentResult:
+    """1つの設定で局面の集合を近似探索し、結果を集計する
+
+    Args:
+        piece_type (str): 駒の種類
+        size (tuple[int, int]): ボードのサイズ（縦, 横）
+        corpus (list[CorpusEntry]): 局面のリスト
+        max_depth (int): 探索の最大深さ
+        num_playout (int): プレイアウトの試行回数
+        leaf_eval (str): プレイアウト方策の名前か"static"
+        seed (int | None): プレイアウトの乱数シード
+
+    Returns:
+        ExperimentResult: 実験結果
+    """
+    static_weights = None
+    playout_policy = leaf_eval
+    if leaf_eval == "static":
+        static_weights = load_static_weights(STATIC_WEIGHTS_PATH, piece_type, size)
+        playout_policy = "random"
+    board = Board(
+        size,
+        (0, 0),
+        piece_type,
+        num_playout,
+        playout_policy,
+        seed=seed,
+        static_weights=static_weights,
+    )
+
+    win_correct = move_correct = node_count = 0
+    start = time.perf_counter()
+    for entry in corpus:
+        board.set_state(*board.decode_state(entry.state))
+        player = board.get_current_player()
+        # 時間と局面数を測るので、前の局面の結果は使わない
+        clear_transposition_table()
+        child_values, nodes = _search_children(board, player, max_depth, True)
+        node_count += nodes
+        choose = max if player else min
+        move = choose(child_values, key=lambda m: child_values[m])
+        first_player_win_prob = child_values[move]
+        win_prob = first_player_win_prob if player else 1.0 - first_player_win_prob
+        win_correct += (win_prob > 0.5) == entry.win
+        move_correct += move in entry.best_moves
+    seconds = time.perf_counter() - start
+    clear_transposition_table()
+    board.close()
+
+    return ExperimentResult(
+        max_depth,
+        num_playout,
+        leaf_eval,
+        seconds,
+        node_count,
+        win_correct / len(corpus),
+        move_correct / len(corpus),
+    )
+
+
+def pareto_front(results: list[ExperimentResult]) -> list[ExperimentResult]:
+    """時間と手の正解率についてパレート最適な結果を時間の短い順に返す
+
+    Args:
+        results (list[ExperimentResult]): 実験結果のリスト
+
+    Returns:
+        list[ExperimentResult]: より短い時間でより高い正解率の結果がないもの
+    """
+    front: list[ExperimentResult] = []
+    for result in sorted(results, key=lambda r: (r.seconds, -r.move_accuracy)):
+        if not front or result.move_accuracy > front[-1].move_accuracy:
+            front.append(result)
+    return front
+
+
+def load_corpus(path: str) -> list[CorpusEntry]:
+    """局面の集合をJSONファイルから読み込む"""
+    with open(path) as f:
+        return [CorpusEntry(**entry) for entry in json.load(f)]
+
+
+def save_corpus(path: str, corpus: list[CorpusEntry]):
+    """局面の集合をJSONファイルに書き出す"""
+    with open(path, "w") as f:
+        json.dump([entry._asdict() for entry in corpus], f)
+
+
+def format_result(result: ExperimentResult) -> str:
+    """実験結果を1行の文字列にする"""
+    playouts = "-" if result.leaf_eval == "static" else str(result.num_playout)
+    return (
+        f"{result.max_depth:5d} {playouts:>7s} {result.leaf_eval:>14s} "
+        f"{result.seconds:9.3f}秒 {result.nodes:12,d} "
+        f"{result.win_accuracy:9.1%} {result.move_accuracy:9.1%}"
+    )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="近似探索の精度とコストの実験")
+    parser.add_argument("height", type=int, help="ボードの縦のサイズ")
+    parser.add_argument("width", type=int, help="ボードの横のサイズ")
+    parser.add_argument("piece_type", type=str, help="駒の種類")
+    parser.add_argument(
+        "--depths", type=int, nargs="+", default=[2, 4, 6], help="max_depthの候補"
+    )
+    parser.add_argument(
+        "--playouts",
+        type=int,
+        nargs="+",
+        default=[10, 100],
+        help="num_playoutの候補",
+    )
+    parser.add_argument(
+        "--leaf-evals",
+        type=str,
+        nargs="+",
+        default=["random", "warnsdorff", "win-aware", "static"],
+        help="プレイアウト方策か静的評価（static）の候補",
+    )
+    parser.add_argument("--positions", type=int, default=50, help="局面数")
+    parser.add_argument(
+        "--max-reachable",
+        type=int,
+        default=16,
+        help="局面の到達可能なマス数の上限（厳密に解くため）",
+    )
+    parser.add_argument(
+        "--corpus",
+        type=str,
+        default=None,
+        help="局面の集合のファイルパス（あれば読み込み、なければ作って書き出す）",
+    )
+    parser.add_argument(
+        "--target",
+        type=float,
+        default=0.9,
+        help="手の正解率の目標（これを満たす最も速い設定を表示する）",
+    )
+    parser.add_argument(
+        "--output", type=str, default=None, help="結果のCSVファイルパス"
+    )
+    parser.add_argument(
+        "--tt-entries",
+        type=int,
+        default=2_000_000,
+        help="局面の集合を解く間に引き継ぐ置換表の登録数の上限",
+    )
+    parser.add_argument("--seed", type=int, default=0, help="乱数シード")
+    args = parser.parse_args()
+
+    set_transposition_table(GenerationalTranspositionTable(args.tt_entries))
+    size = (args.height, args.width)
+    if args.corpus is not None and os.path.exists(args.corpus):
+        corpus = load_corpus(args.corpus)
+    else:
+        corpus = create_corpus(
+            args.piece_type,
+            size,
+            args.positions,
+            args.max_reachable,
+            random.Random(args.seed),
+        )
+        if args.corpus is not None:
+            save_corpus(args.corpus, corpus)
+    print(f"局面数: {len(corpus)}")
+
+    results: list[ExperimentResult] = []
+    print(
+        "深さ プレイアウト      葉の評価       時間       局面数  勝敗正解率  手正解率"
+    )
+    for max_depth, leaf_eval in itertools.product(args.depths, args.leaf_evals):
+        # 静的評価はプレイアウト回数によらないので1回だけ行う
+        playouts = args.playouts[:1] if leaf_eval == "static" else args.playouts
+        for num_playout in playouts:
+            result = run_experiment(
+                args.piece_type,
+                size,
+                corpus,
+                max_depth,
+                num_playout,
+                leaf_eval,
+                args.seed,
+            )
+            results.append(result)
+            print(format_result(result))
+
+    front = pareto_front(results)
+    print("\nパレート最適な設定（時間の短い順）")
+    for result in front:
+        print(format_result(result))
+    meeting = [r for r in front if r.move_accuracy >= args.target]
+    if meeting:
+        print(f"\n手の正解率{args.target:.0%}以上で最も速い設定")
+        print(format_result(meeting[0]))
+    else:
+        print(f"\n手の正解率{args.target:.0%}を満たす設定はありません")
+
+    if args.output is not None:
+        with open(args.output, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow([*ExperimentResult._fields, "pareto"])
+            for result in results:
+                writer.writerow([*result, result in front])
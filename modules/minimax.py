@@ -1,8 +1,228 @@
 """minimax法の実装"""
 
+import time
+from collections import deque
+from collections.abc import Generator
+
 from .board import Board
+from .parity import BipartiteSolver
+from .report import SearchReport
+from .residual import ResidualCache
+from .ttable import (
+    GenerationalTranspositionTable,
+    MainTable,
+    TwoLevelTranspositionTable,
+)
+
+# 葉の評価要求 (盤面, 駒の位置, 手番) のリスト
+LeafRequests = list[tuple[int, int, bool]]
+# 葉の評価要求をyieldし、評価値を受け取って再開し、(先手の勝利確率, 探索した局面数) を返す探索コルーチン
+LeafCoroutine = Generator[LeafRequests, list[float], tuple[float, int]]
+
+# 置換表（状態キー -> 先手の勝利確率）として使える型
+TranspositionTable = MainTable | TwoLevelTranspositionTable
+
+# 置換表。厳密な探索ではコンパクトな表に、続けて探索する場合は世代付きの表に、
+# メモリに収まらない場合はディスクへ書き出す表に置き換えられる（それぞれの前に小さな表を置くこともある）
+_transposition_table: TranspositionTable = {}
+
+# 終盤の残余グラフの同型キャッシュ（Noneなら使わない）
+_residual_cache: ResidualCache | None = None
+
+# 二部グラフの移動グラフで勝敗を求めるソルバー（Noneなら使わない）
+_bipartite_solver: BipartiteSolver | None = None
+
+
+class SearchAborted(Exception):
+    """探索が予算を使い切って打ち切られたことを表す例外"""
+
+
+class SearchProgress:
+    def __init__(self, node_budget: int | None, time_budget: float | None):
+        """探索の進捗と、深さごとの部分木の大きさを記録する
+
+        各局面に親の重みを子の数で割った重み（ルートは1）を割り当て、
+        探索し終えた局面や枝刈りで探索しなくなった子の重みを足し合わせて探索済みの割合とする。
+
+        Args:
+            node_budget (int | None): 探索局面数の予算（超えるとSearchAbortedを送出する）
+            time_budget (float | None): 探索時間の予算（秒）
+        """
+        self.node_budget = node_budget
+        self.time_budget = time_budget
+        self.start = time.perf_counter()
+        self.nodes = 0
+        self.done = 0.0  # 探索済みの割合
+        # 展開中の局面ごとの [重み, 子の数, 探索を始めた子の数]
+        self.frames: list[list[float]] = []
+        # 深さごとの、探索し終えた局面の数と局面数の合計
+        self.completed_counts: list[int] = []
+        self.completed_nodes: list[int] = []
+        # 深さごとの、展開し終えた局面の数、その子の数の合計、探索した子の数の合計
+        self.expanded_counts: list[int] = []
+        self.child_slots: list[int] = []
+        self.child_searched: list[int] = []
+        # 深さごとの、置換表や残余グラフの結果で子を展開せずに済んだ局面の数
+        self.shortcut_counts: list[int] = []
+        # 別のスレッドから探索の中止を求められたかどうか
+        self.stopped = False
+
+    def stop(self):
+        """探索の中止を求める（次に予算を確かめたときにSearchAbortedを送出する）"""
+        self.stopped = True
+
+    def count_node(self):
+        """局面を1つ数え、予算を超えていれば探索を打ち切る"""
+        self.nodes += 1
+        if self.nodes % 1024:
+            return
+        elapsed = time.perf_counter() - self.start
+        if (
+            self.stopped
+            or (self.node_budget is not None and self.nodes >= self.node_budget)
+            or (self.time_budget is not None and elapsed >= self.time_budget)
+        ):
+            raise SearchAborted
+
+    def finish_node(self, node_count: int, shortcut: bool = False):
+        """子を展開せずに終わった局面を記録する
+
+        Args:
+            node_count (int): その局面で数えた局面数（置換表にあった場合は0）
+            shortcut (bool): 子があっても置換表や残余グラフの結果で展開を省いたかどうか
+        """
+        self.done += self.frames[-1][0] / self.frames[-1][1] if self.frames else 1.0
+        depth = len(self.frames)
+        self._record_completed(depth, node_count)
+        if shortcut:
+            self.shortcut_counts[depth] += 1
+
+    def enter_children(self, num_children: int):
+        """子の探索を始める
+
+        Args:
+            num_children (int): 子の数
+        """
+        weight = self.frames[-1][0] / self.frames[-1][1] if self.frames else 1.0
+        self.frames.append([weight, num_children, 0])
+
+    def next_child(self):
+        """次の子の探索を始める"""
+        self.frames[-1][2] += 1
+
+    def leave_children(self, node_count: int):
+        """子の探索を終える（枝刈りで探索しなかった子の重みを探索済みとする）
+
+        Args:
+            node_count (int): その局面以下で数えた局面数
+        """
+        weight, num_children, num_searched = self.frames.pop()
+        self.done += weight * (num_children - num_searched) / num_children
+        depth = len(self.frames)
+        while len(self.child_slots) <= depth:
+            self.expanded_counts.append(0)
+            self.child_slots.append(0)
+            self.child_searched.append(0)
+        self.expanded_counts[depth] += 1
+        self.child_slots[depth] += int(num_children)
+        self.child_searched[depth] += int(num_searched)
+        self._record_completed(depth, node_count)
+
+    def _record_completed(self, depth: int, node_count: int):
+        while len(self.completed_counts) <= depth:
+            self.completed_counts.append(0)
+            self.completed_nodes.append(0)
+            self.shortcut_counts.append(0)
+        self.completed_counts[depth] += 1
+        self.completed_nodes[depth] += node_count
+
+
+# 探索の進捗の記録先（Noneなら記録しない）
+_search_progress: SearchProgress | None = None
 
-_transposition_table: dict[int, float] = {}
+
+# 手順ごとの内訳の記録先（Noneなら記録しない）
+_search_report: SearchReport | None = None
+
+
+def set_search_report(report: SearchReport | None):
+    """minimaxで手順ごとの内訳を記録する先を設定する
+
+    Args:
+        report (SearchReport | None): 内訳の記録先（Noneなら記録しない）
+    """
+    global _search_report
+    _search_report = report
+
+
+def set_search_progress(progress: SearchProgress | None):
+    """minimaxで探索の進捗を記録する先を設定する
+
+    Args:
+        progress (SearchProgress | None): 進捗の記録先（Noneなら記録しない）
+    """
+    global _search_progress
+    _search_progress = progress
+
+
+def clear_transposition_table():
+    """置換表を空にする（別の局面や設定で探索し直す前に呼ぶ）"""
+    _transposition_table.clear()
+
+
+def set_transposition_table(table: TranspositionTable):
+    """探索で使う置換表を設定する
+
+    Args:
+        table (TranspositionTable): 置換表
+            （コンパクトな表は勝敗しか記録できないので、葉を評価しない厳密な探索でのみ使える）
+    """
+    global _transposition_table
+    _transposition_table = table
+
+
+def begin_search(board: Board, exact: bool):
+    """1つのプロセスで続けて行う探索の1つを始める
+
+    世代付きの置換表なら世代を進めて前の探索の厳密な値を引き継ぎ、それ以外の置換表は空にする。
+    2段の置換表ではL1を空にし、下の段を同じように扱う。正規化の統計の統合の判定用の記録も空にする。
+
+    Args:
+        board (Board): 探索するチェスボード
+        exact (bool): 葉を評価しない厳密な探索かどうか
+    """
+    board.clear_seen_raw_keys()
+    table = _transposition_table
+    if isinstance(table, TwoLevelTranspositionTable):
+        # L1には前の探索の近似値が残っていることがあるので、下の段の扱いによらず空にする
+        table.clear_l1()
+        table = table.main
+    if isinstance(table, GenerationalTranspositionTable):
+        table.begin_search(board.get_key_signature(), exact)
+    else:
+        table.clear()
+
+
+def set_residual_cache(cache: ResidualCache | None):
+    """探索で使う残余グラフの同型キャッシュを設定する
+
+    Args:
+        cache (ResidualCache | None): 残余グラフの同型キャッシュ（Noneなら使わない）
+    """
+    global _residual_cache
+    _residual_cache = cache
+
+
+def set_bipartite_solver(solver: BipartiteSolver | None):
+    """探索で使う二部グラフのソルバーを設定する
+
+    移動グラフが二部グラフでないボードでは何もしない。
+
+    Args:
+        solver (BipartiteSolver | None): 二部グラフのソルバー（Noneなら使わない）
+    """
+    global _bipartite_solver
+    _bipartite_solver = solver
 
 
 def minimax(
@@ -31,16 +251,40 @@ def minimax(
         tuple[float, int]: (先手の勝利確率, 探索した局面数)
     """
     # transposition tableのキーを生成
+    progress = _search_progress
+    report = _search_report
     state_key = board.get_state_key()
-    if state_key in _transposition_table:
-        return _transposition_table[state_key], 0
+    cached = _transposition_table.get(state_key)
+    if cached is not None:
+        board.record_symmetry_merge()
+        if progress is not None:
+            progress.finish_node(0, shortcut=True)
+        if report is not None:
+            report.count_tt_hit()
+        return cached, 0
     # 局面数をカウント（この関数が呼ばれるたびに1局面）
     node_count = 1
+    if progress is not None:
+        progress.count_node()
+    if report is not None:
+        report.count_node()
 
-    # 一定深さではプレイアウトの結果を返す
+    # 残余グラフが小さければ同型キャッシュから、二部グラフなら最大マッチングから厳密な結果を引く
+    residual_result = _probe_residual_cache(board, player)
+    if residual_result is None:
+        residual_result = _probe_bipartite(board, player)
+    if residual_result is not None:
+        _transposition_table[state_key] = residual_result
+        if progress is not None:
+            progress.finish_node(node_count, shortcut=True)
+        return residual_result, node_count
+
+    # 一定深さでは葉の評価値（プレイアウトか静的評価）を返す
     if depth >= max_depth:
         # 先手の勝率を取得
-        first_player_win_prob = board.get_playout_result(player)
+        first_player_win_prob = board.get_leaf_result(player)
+        if progress is not None:
+            progress.finish_node(node_count)
         return first_player_win_prob, node_count
 
     # 移動できるマスを取得する
@@ -50,6 +294,8 @@ def minimax(
     if not available_positions:
         # 現在のプレイヤーの負け、つまり、もう一方のプレイヤーの勝ち
         _transposition_table[state_key] = 0.0 if player else 1.0
+        if progress is not None:
+            progress.finish_node(node_count)
         return (0.0 if player else 1.0), node_count
 
     # 移動順序を最適化
@@ -65,14 +311,21 @@ def minimax(
     # 先手(True)なら最大値を、後手(False)なら最小値を初期値に設定
     best_value = 0.0 if player else 1.0
 
+    if progress is not None:
+        progress.enter_children(len(available_positions))
+
     # 可能な移動を順番に試していく
     for position in available_positions:
+        if progress is not None:
+            progress.next_child()
         if verbose:
             print(" " * (depth * 2 + 2), end="")
             print(f"{'先手' if player else '後手'} chose {position}")
 
         # 駒を移動する
         original_pos = board.make_move(position)
+        if report is not None:
+            report.push(position)
 
         # 移動結果を再帰的に評価する
         result, child_nodes = minimax(
@@ -87,6 +340,8 @@ def minimax(
         )
         node_count += child_nodes
         board.undo_move(position, original_pos)
+        if report is not None:
+            report.pop(result, child_nodes)
 
         # Alpha-Beta枝刈り
         if player:
@@ -104,23 +359,326 @@ def minimax(
             if alpha >= beta:
                 break
 
+    if progress is not None:
+        progress.leave_children(node_count)
+
     _transposition_table[state_key] = best_value
     return best_value, node_count
 
 
+def _probe_residual_cache(board: Board, player: bool) -> float | None:
+    """残余グラフの同型キャッシュから現在の局面の先手勝率を引く
+
+    Args:
+        board (Board): 現在のチェスボードの状態
+        player (bool): 現在のプレイヤー（True: 先手, False: 後手）
+
+    Returns:
+        float | None: 先手の勝利確率（キャッシュを使えない場合はNone）
+    """
+    if _residual_cache is None:
+        return None
+    player_wins = _residual_cache.lookup(board)
+    if player_wins is None:
+        return None
+    # 手番のプレイヤーの勝敗を先手の勝率に直す
+    return 1.0 if player_wins == player else 0.0
+
+
+def _probe_bipartite(board: Board, player: bool) -> float | None:
+    """移動グラフが二部グラフなら、色の偶奇と最大マッチングから現在の局面の先手勝率を求める
+
+    Args:
+        board (Board): 現在のチェスボードの状態
+        player (bool): 現在のプレイヤー（True: 先手, False: 後手）
+
+    Returns:
+        float | None: 先手の勝利確率（ソルバーを使えない場合はNone）
+    """
+    if _bipartite_solver is None:
+        return None
+    player_wins = _bipartite_solver.lookup(board)
+    if player_wins is None:
+        return None
+    return 1.0 if player_wins == player else 0.0
+
+
 def _sort_moves_by_heuristic(board: Board, positions: list[int]):
     """ヒューリスティクスに基づき移動候補を並べ替える
 
     移動後に相手の選択肢が少なくなる手を優先する。
     また、盤面の端や隅に近い位置も優先する。
+    各特徴量の重みはboard.ordering_weightsで与えられる。
 
     Args:
         board (Board): 現在のチェスボードの状態
         positions (list[int]): 移動候補のリスト
     """
+    weights = board.ordering_weights
+    w_mobility, w_center, w_onward = (
+        weights["mobility"],
+        weights["center"],
+        weights["onward"],
+    )
+    visited = board.board
+    moves_map = board.available_positions_map
 
     def score(pos: int) -> float:
         # 移動可能な位置数が少ない位置を優先して相手の選択肢を減らし、端に近い位置を優先して詰みやすくする
-        return -board.mobility_map[pos] * 5 + board.dist_from_center_map[pos]
+        value = w_mobility * board.mobility_map[pos]
+        value += w_center * board.dist_from_center_map[pos]
+        if w_onward:
+            # 移動後に相手が実際に動ける手の数
+            value += w_onward * (moves_map[pos] & ~visited).bit_count()
+        return value
 
     positions.sort(key=score, reverse=True)
+
+
+def minimax_batched(
+    board: Board,
+    player: bool,
+    heuristic: bool,
+    max_depth: int,
+    batch_size: int,
+) -> tuple[float, int]:
+    """葉の評価をまとめて行うminimax法でゲーム木を探索する
+
+    ルートの各子局面の探索をコルーチンとして並行に進め、max_depthに達した葉で中断させる。
+    中断中のコルーチンから集めた葉をbatch_size個程度ずつまとめてBoard.get_leaf_resultsで評価し、
+    結果を送り返して探索を再開する。
+    そのためルートの子局面の間ではAlpha-Beta枝刈りが効かず、葉の直前の局面でも子をすべて評価する。
+
+    Args:
+        board (Board): 現在のチェスボードの状態
+        player (bool): 現在のプレイヤー（True: 先手, False: 後手）
+        heuristic (bool): 移動順序の最適化を行うかどうか
+        max_depth (int): 探索の最大深さ
+        batch_size (int): 1回にまとめて評価する葉の数の目安
+
+    Returns:
+        tuple[float, int]: (先手の勝利確率, 探索した局面数)
+    """
+    root_board, root_pos = board.get_state()
+    available_positions = board.get_available_positions()
+    if max_depth <= 0 or not available_positions:
+        # ルート自体が葉か終局なら並行に進めるものがない
+        return _run_coroutines(
+            board,
+            [
+                _minimax_coroutine(
+                    board,
+                    root_board,
+                    root_pos,
+                    0,
+                    player,
+                    heuristic,
+                    max_depth,
+                    0.0,
+                    1.0,
+                )
+            ],
+            player,
+            batch_size,
+        )
+
+    if heuristic:
+        _sort_moves_by_heuristic(board, available_positions)
+
+    coroutines = [
+        _minimax_coroutine(
+            board,
+            root_board | (1 << position),
+            position,
+            1,
+            not player,
+            heuristic,
+            max_depth,
+            0.0,
+            1.0,
+        )
+        for position in available_positions
+    ]
+    best_value, node_count = _run_coroutines(board, coroutines, player, batch_size)
+    board.set_state(root_board, root_pos)
+    _transposition_table[board.get_state_key()] = best_value
+    return best_value, node_count + 1
+
+
+def _run_coroutines(
+    board: Board,
+    coroutines: list[LeafCoroutine],
+    player: bool,
+    batch_size: int,
+) -> tuple[float, int]:
+    """探索コルーチンを進め、中断中の葉をまとめて評価しながら結果を集約する
+
+    Args:
+        board (Board): チェスボード（葉の評価に使う）
+        coroutines (list[Generator]): 兄弟局面の探索コルーチンのリスト
+        player (bool): 兄弟局面の親の手番（True: 先手, False: 後手）
+        batch_size (int): 1回にまとめて評価する葉の数の目安
+
+    Returns:
+        tuple[float, int]: (親から見た最善の先手の勝利確率, 探索した局面数)
+    """
+    best_value = 0.0 if player else 1.0
+    node_count = 0
+    # 評価待ちのコルーチンと、送り返す値
+    ready: deque[tuple[LeafCoroutine, list[float] | None]] = deque(
+        (c, None) for c in coroutines
+    )
+    waiting: list[tuple[LeafCoroutine, LeafRequests]] = []
+
+    while ready or waiting:
+        # 評価待ちの葉がbatch_size個に達するか、進められるコルーチンがなくなるまで進める
+        while ready and sum(len(r) for _, r in waiting) < batch_size:
+            coroutine, values = ready.popleft()
+            try:
+                requests = coroutine.send(values)  # type: ignore[arg-type]
+            except StopIteration as stop:
+                result, child_nodes = stop.value
+                node_count += child_nodes
+                if player:
+                    best_value = max(best_value, result)
+                else:
+                    best_value = min(best_value, result)
+                if best_value == (1.0 if player else 0.0):
+                    # 必勝手が見つかったので残りの兄弟局面は探索しない
+                    for c, _ in ready:
+                        c.close()
+                    for c, _ in waiting:
+                        c.close()
+                    return best_value, node_count
+                continue
+            waiting.append((coroutine, requests))
+
+        if not waiting:
+            continue
+
+        # 中断中の葉をまとめて評価し、それぞれのコルーチンに結果を割り振る
+        batch = [request for _, requests in waiting for request in requests]
+        results = board.get_leaf_results(batch)
+        offset = 0
+        for coroutine, requests in waiting:
+            ready.append((coroutine, results[offset : offset + len(requests)]))
+            offset += len(requests)
+        waiting = []
+
+    return best_value, node_count
+
+
+def _minimax_coroutine(
+    board: Board,
+    visited: int,
+    position: int,
+    depth: int,
+    player: bool,
+    heuristic: bool,
+    max_depth: int,
+    alpha: float,
+    beta: float,
+) -> LeafCoroutine:
+    """葉の評価で中断するminimax法の探索コルーチン
+
+    葉の評価が必要になると評価要求のリストをyieldし、同じ順の評価値のリストを受け取って再開する。
+    他のコルーチンと同じBoardを共有するため、Boardを使う前に必ず自分の状態を設定し直す。
+
+    Args:
+        board (Board): 共有のチェスボード
+        visited (int): 盤面のビット表現
+        position (int): 駒の位置のインデックス
+        depth (int): 探索の深さ
+        player (bool): 現在のプレイヤー（True: 先手, False: 後手）
+        heuristic (bool): 移動順序の最適化を行うかどうか
+        max_depth (int): 探索の最大深さ
+        alpha (float): Alpha値
+        beta (float): Beta値
+
+    Returns:
+        tuple[float, int]: (先手の勝利確率, 探索した局面数)
+    """
+    board.set_state(visited, position)
+    state_key = board.get_state_key()
+    cached = _transposition_table.get(state_key)
+    if cached is not None:
+        board.record_symmetry_merge()
+        return cached, 0
+    node_count = 1
+
+    residual_result = _probe_residual_cache(board, player)
+    if residual_result is None:
+        residual_result = _probe_bipartite(board, player)
+    if residual_result is not None:
+        _transposition_table[state_key] = residual_result
+        return residual_result, node_count
+
+    # 一定深さでは葉の評価値（プレイアウトか静的評価）を返す
+    if depth >= max_depth:
+        (first_player_win_prob,) = yield [(visited, position, player)]
+        return first_player_win_prob, node_count
+
+    available_positions = board.get_available_positions()
+    if not available_positions:
+        _transposition_table[state_key] = 0.0 if player else 1.0
+        return (0.0 if player else 1.0), node_count
+
+    if heuristic:
+        _sort_moves_by_heuristic(board, available_positions)
+
+    best_value = 0.0 if player else 1.0
+
+    if depth + 1 >= max_depth:
+        # 子局面はすべて葉なので、置換表にないものをまとめて評価する
+        results: list[float] = []
+        requests: LeafRequests = []
+        for next_position in available_positions:
+            next_visited = visited | (1 << next_position)
+            board.set_state(next_visited, next_position)
+            child_key = board.get_state_key()
+            cached = _transposition_table.get(child_key)
+            if cached is not None:
+                board.record_symmetry_merge()
+                results.append(cached)
+                continue
+            node_count += 1
+            residual_result = _probe_residual_cache(board, not player)
+            if residual_result is None:
+                residual_result = _probe_bipartite(board, not player)
+            if residual_result is not None:
+                _transposition_table[child_key] = residual_result
+                results.append(residual_result)
+            else:
+                requests.append((next_visited, next_position, not player))
+        if requests:
+            results.extend((yield requests))
+        best_value = max(results) if player else min(results)
+        _transposition_table[state_key] = best_value
+        return best_value, node_count
+
+    for next_position in available_positions:
+        result, child_nodes = yield from _minimax_coroutine(
+            board,
+            visited | (1 << next_position),
+            next_position,
+            depth + 1,
+            not player,
+            heuristic,
+            max_depth,
+            alpha,
+            beta,
+        )
+        node_count += child_nodes
+
+        # Alpha-Beta枝刈り
+        if player:
+            best_value = max(best_value, result)
+            alpha = max(alpha, best_value)
+        else:
+            best_value = min(best_value, result)
+            beta = min(beta, best_value)
+        if alpha >= beta:
+            break
+
+    _transposition_table[state_key] = best_value
+    return best_value, node_count
@@ -0,0 +1,95 @@
+"""二部グラフの移動グラフでの色の偶奇による枝刈り
+
+ナイトの移動グラフのように移動グラフが二部グラフなら、駒は1手ごとに色を変える。
+駒の位置vの色のマスの集合をP（vを含む）、他方の色の到達可能なマスの集合をQとすると、手番の勝敗は次のように決まる。
+
+- Qが空なら動けないので手番の負け、Pがvだけなら（Qは空でない）どこへ動いても相手が動けないので手番の勝ち
+- それ以外は、vと到達可能なマスからなるグラフのすべての最大マッチングがvを含むときに限り手番の勝ち
+  （無向グラフ上のgeographyの定理。vを含む最大マッチングMがあれば、手番はMに沿って動き続けられる）
+
+後者はP - {v}からQへの最大マッチングを作った後、vからの増加路があるか（Hallの条件の意味でvを加えても不足がないか）で判定できる。
+いずれも到達可能なマス数の多項式時間で求まるので、局面を展開せずに厳密な勝敗が決まる。
+"""
+
+from typing import TYPE_CHECKING
+
+if TYPE_CHECKING:
+    from .board import Board
+
+
+class BipartiteSolver:
+    def __init__(self):
+        """二部グラフの移動グラフで局面の勝敗を求める"""
+        self.count_settled = 0  # 色ごとのマス数だけで勝敗が決まった回数
+        self.matching_settled = 0  # 最大マッチングで勝敗が決まった回数
+
+    def lookup(self, board: "Board") -> bool | None:
+        """現在の局面で手番のプレイヤーが勝つかを求める
+
+        Args:
+            board (Board): 現在のチェスボードの状態
+
+        Returns:
+            bool | None: 手番のプレイヤーが勝つか（移動グラフが二部グラフでなければNone）
+        """
+        color_mask = board.color_mask
+        if color_mask is None:
+            return None
+        position = board.pos
+        reachable = board.get_reachable_mask()
+        # 駒の位置と同じ色のマスをsame、異なる色のマスをotherとする
+        if (color_mask >> position) & 1:
+            same, other = reachable & color_mask, reachable & ~color_mask
+        else:
+            same, other = reachable & ~color_mask, reachable & color_mask
+        if not other or not same:
+            self.count_settled += 1
+            return bool(other)
+
+        self.matching_settled += 1
+        return has_augmenting_path(board.available_positions_map, position, same, other)
+
+
+def has_augmenting_path(moves_map: list[int], root: int, same: int, other: int) -> bool:
+    """sameからotherへの最大マッチングを作り、rootを加えると最大マッチングが大きくなるかを判定する
+
+    Kuhnの方法で、sameの各頂点から交互路をビットボードで辿って増加路を探す。
+
+    Args:
+        moves_map (list[int]): 各位置から移動可能な位置のビットマスクのリスト
+        root (int): 駒の位置（sameには含めない）
+        same (int): 駒の位置と同じ色の到達可能なマスのビットマスク
+        other (int): 駒の位置と異なる色の到達可能なマスのビットマスク
+
+    Returns:
+        bool: rootからの増加路があるか（すべての最大マッチングがrootを含むか）
+    """
+    # otherのマス -> マッチングの相手のsameのマス
+    partner: dict[int, int] = {}
+    seen = 0
+
+    def augment(v: int) -> bool:
+        nonlocal seen
+        candidates = moves_map[v] & other & ~seen
+        seen |= candidates
+        while candidates:
+            bit = candidates & -candidates
+            candidates ^= bit
+            u = bit.bit_length() - 1
+            w = partner.get(u)
+            if w is None or augment(w):
+                partner[u] = v
+                return True
+        return False
+
+    rest = same
+    while rest:
+        bit = rest & -rest
+        rest ^= bit
+        seen = 0
+        augment(bit.bit_length() - 1)
+        if len(partner) == other.bit_count():
+            # otherがすべてマッチしたら、rootからの増加路はない
+            return False
+    seen = 0
+    return augment(root)
@@ -0,0 +1,124 @@
+"""移動生成のperft（手順の数え上げ）による速度測定
+
+現在の状態から深さdまでのすべての合法な手順を、枝刈りも置換表も使わずに数える（深さdに達した手順の数）。
+最後の1手は指さずに、移動可能なマスのビットマスクのpopcountでまとめて数える。
+Board.get_available_positions, make_move, undo_moveだけを使うので、移動生成の速さ（局面/秒）を測れ、
+既知の数と比べることで移動生成の正しさも確かめられる。
+"""
+
+import argparse
+import sys
+import time
+
+from .board import Board
+
+# (駒の種類, ボードのサイズ, 初期位置, 深さ) -> 既知の手順の数（1手ずつ指して数えた値）
+KNOWN_PERFT: dict[tuple[str, tuple[int, int], tuple[int, int], int], int] = {
+    ("rook", (4, 4), (0, 0), 6): 9792,
+    ("king", (4, 4), (0, 0), 7): 10918,
+    ("queen", (4, 4), (1, 1), 7): 1157588,
+    ("knight", (5, 5), (0, 0), 10): 22822,
+    ("knight", (8, 8), (0, 0), 9): 539536,
+    ("king", (8, 8), (3, 3), 7): 280046,
+}
+
+
+def perft(board: Board, depth: int) -> int:
+    """現在の状態から深さdepthまでの合法な手順の数を数える
+
+    Args:
+        board (Board): チェスボード（終了時に元の状態に戻る）
+        depth (int): 深さ（0なら1）
+
+    Returns:
+        int: 深さdepthに達した手順の数
+    """
+    if depth == 0:
+        return 1
+    if depth == 1:
+        # 最後の1手は指さずに、移動可能なマスの数で数える
+        return (board.available_positions_map[board.pos] & ~board.board).bit_count()
+    count = 0
+    for position in board.get_available_positions():
+        original_pos = board.make_move(position)
+        count += perft(board, depth - 1)
+        board.undo_move(position, original_pos)
+    return count
+
+
+def perft_divide(board: Board, depth: int) -> list[tuple[int, int]]:
+    """最初の手ごとに深さdepthまでの手順の数を数える（移動生成の誤りの場所を絞り込むのに使う）
+
+    Args:
+        board (Board): チェスボード（終了時に元の状態に戻る）
+        depth (int): 深さ（1以上）
+
+    Returns:
+        list[tuple[int, int]]: (最初の手の移動先, 手順の数) のリスト
+    """
+    counts: list[tuple[int, int]] = []
+    for position in board.get_available_positions():
+        original_pos = board.make_move(position)
+        counts.append((position, perft(board, depth - 1)))
+        board.undo_move(position, original_pos)
+    return counts
+
+
+def run_perft(board: Board, max_depth: int) -> list[tuple[int, int, float]]:
+    """深さ1からmax_depthまでのperftを順に行い、数と時間を測る
+
+    Args:
+        board (Board): チェスボード
+        max_depth (int): 深さの上限
+
+    Returns:
+        list[tuple[int, int, float]]: (深さ, 手順の数, 時間（秒）) のリスト
+    """
+    results: list[tuple[int, int, float]] = []
+    for depth in range(1, max_depth + 1):
+        start = time.perf_counter()
+        count = perft(board, depth)
+        results.append((depth, count, time.perf_counter() - start))
+    return results
+
+
+def print_perft(results: list[tuple[int, int, float]]):
+    """perftの結果を深さごとに表示する
+
+    Args:
+        results (list[tuple[int, int, float]]): (深さ, 手順の数, 時間（秒）) のリスト
+    """
+    print("深さ         手順数       時間       手順/秒")
+    for depth, count, seconds in results:
+        rate = count / max(seconds, 1e-9)
+        print(f"{depth:>4} {count:>14,} {seconds:>9.3f}秒 {rate:>13,.0f}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description="既知の手順の数との照合と移動生成の速度測定"
+    )
+    parser.add_argument(
+        "--repeat", type=int, default=3, help="各局面の測定回数（最短の時間を使う）"
+    )
+    args = parser.parse_args()
+
+    mismatches = 0
+    print("駒      ボード 初期位置 深さ         手順数       時間       手順/秒")
+    for (piece_type, size, position, depth), expected in KNOWN_PERFT.items():
+        board = Board(size, position, piece_type, 0)
+        best = float("inf")
+        for _ in range(args.repeat):
+            start = time.perf_counter()
+            count = perft(board, depth)
+            best = min(best, time.perf_counter() - start)
+        status = "" if count == expected else f"  不一致（既知の値 {expected:,}）"
+        mismatches += count != expected
+        print(
+            f"{piece_type:<7} {size[0]}x{size[1]} {position!s:>8} {depth:>4} "
+            f"{count:>14,} {best:>9.3f}秒 {count / best:>13,.0f}{status}"
+        )
+    if mismatches:
+        print(f"{mismatches}件の手順の数が既知の値と一致しませんでした")
+        sys.exit(1)
+    print("すべての手順の数が既知の値と一致しました")
@@ -0,0 +1,378 @@
+"""探索エンジンと設定の自動選択
+
+ボードサイズ、駒の種類、移動グラフの性質（二部グラフか、密度）と、
+求める出力（厳密解か近似解か）から探索の設定を選び、その理由を記録する。
+"""
+
+import math
+import os
+import random
+from typing import NamedTuple
+
+from .board import Board
+from .estimate import CONFIDENCE_Z, SearchEstimate, estimate_search, format_seconds
+from .minimax import set_residual_cache
+from .residual import ResidualCache
+
+# 残余グラフのキャッシュを使う頂点数の上限。厳密な探索で0・8〜24頂点を比べると、キング・ルーク・クイーンの
+# いずれの密度でも大きいほど速く、20頂点で頭打ちになった（キング6x6で0頂点の約14倍、24頂点と同程度）
+_RESIDUAL_VERTICES = 20
+# 近似解の葉1つあたりのプレイアウト回数
+_APPROXIMATE_PLAYOUTS = 100
+# 近似解で葉をまとめて評価する際の1回あたりの葉の数（実測で決めた値ではない）
+_APPROXIMATE_BATCH_SIZE = 64
+# 近似解の打ち切る深さを「この値 / 平均分岐数」とする（実測で決めた値ではない）
+_APPROXIMATE_DEPTH_BUDGET = 24
+# 近似解のプレイアウト方策。modules.experimentで8x8（到達可能なマス18以下の40局面、深さ2）を比べると、
+# warnsdorffはwin-awareより勝敗の正解率がキング92.5%対85.0%、ルーク95.0%対80.0%、クイーンは同じ100%で、
+# どの駒でも速かった（6x6のキングだけはwin-awareが96.7%対90.0%で上回ったが、1.6倍遅かった）
+_APPROXIMATE_PLAYOUT_POLICY = "warnsdorff"
+# 辞書の置換表の1登録あたりのバイト数（tracemallocで測った約88バイトに余裕を持たせる）
+_DICT_ENTRY_BYTES = 100
+# 置換表に使ってよい物理メモリの割合
+_TABLE_MEMORY_FRACTION = 0.5
+# ゲームの長さを見積もるランダムな対局の回数
+_GAME_LENGTH_GAMES = 1000
+
+
+class MoveGraphInfo:
+    def __init__(self, board: Board):
+        """駒の移動グラフの性質を調べる
+
+        Args:
+            board (Board): チェスボード
+        """
+        self.num_vertices = board.len
+        self.num_edges = sum(board.mobility_map) // 2
+        self.max_degree = max(board.mobility_map)
+        self.density = (
+            2 * self.num_edges / (board.len * (board.len - 1)) if board.len > 1 else 0.0
+        )
+        self.bipartite = board.color_mask is not None
+
+
+class GameLength(NamedTuple):
+    """現在の局面から終局までの手数の見積もり（両者が一様ランダムに手を選んだ場合）"""
+
+    mean: float
+    low: float
+    high: float
+
+
+class SearchPlan:
+    def __init__(self, goal: str, game_length: GameLength):
+        """探索の設定と、それを選んだ理由を初期化する
+
+        Args:
+            goal (str): 求める出力（"exact", "approximate", "length"）
+            game_length (GameLength): 終局までの手数の見積もり
+        """
+        self.goal = goal
+        self.game_length = game_length
+        # main.pyの引数名 -> 値
+        self.settings: dict[str, object] = {}
+        self.reasons: list[str] = []
+
+    def set(self, name: str, value: object, reason: str):
+        """設定を1つ決める
+
+        Args:
+            name (str): main.pyの引数名
+            value (object): 値
+            reason (str): 選んだ理由
+        """
+        self.settings[name] = value
+        self.reasons.append(f"{name}={value}: {reason}")
+
+    def print(self):
+        """選んだ設定と理由、ゲームの長さの見積もりを表示する"""
+        goal_names = {
+            "exact": "厳密解",
+            "approximate": "近似解",
+            "length": "ゲームの長さ",
+        }
+        print(f"エンジン選択: {goal_names[self.goal]}")
+        for reason in self.reasons:
+            print(f"  {reason}")
+        print(
+            f"ゲームの長さ（ランダムな手で終局までの手数）: {self.game_length.mean:.1f}手 "
+            f"(95%信頼区間: {self.game_length.low:.1f}〜{self.game_length.high:.1f}手)"
+        )
+
+
+def plan_search(board: Board, goal: str, time_limit: float) -> SearchPlan:
+    """探索の設定を選ぶ
+
+    goalが"auto"なら、厳密な探索の時間を見積もってtime_limit以内なら厳密解、超えるなら近似解を選ぶ。
+    移動グラフが二部グラフなら、二部グラフのソルバーがルートで厳密な勝敗を決めるので見積もらずに厳密解とする。
+    移動順序の最適化の有無は、両方の探索を選んだ設定と短い予算で見積もって速い方を選ぶ。
+    goalが"length"なら探索はせず、ゲームの長さの見積もりだけを出力とする。
+
+    Args:
+        board (Board): 探索を始めるチェスボードの状態
+        goal (str): 求める出力（"exact", "approximate", "auto", "length"）
+        time_limit (float): 厳密な探索に許す時間（秒）
+
+    Returns:
+        SearchPlan: 選んだ設定
+    """
+    info = MoveGraphInfo(board)
+    graph_desc = (
+        f"{board.piece_type}の移動グラフは頂点{info.num_vertices}・辺{info.num_edges}・"
+        f"密度{info.density:.2f}{'・二部グラフ' if info.bipartite else ''}"
+    )
+    game_length = estimate_game_length(board, _GAME_LENGTH_GAMES)
+    if goal == "length":
+        plan = SearchPlan(goal, game_length)
+        plan.reasons.append(
+            f"両者が一様ランダムに手を選ぶ対局を{_GAME_LENGTH_GAMES}回行った手数の平均"
+        )
+        return plan
+    # 見積もりのために探索する時間の上限
+    probe_seconds = min(5.0, time_limit / 10)
+
+    if info.bipartite:
+        # 二部グラフのソルバーは局面を展開せずに厳密な勝敗を決めるので、探索の見積もりはいらない
+        plan = SearchPlan("exact", game_length)
+        if goal == "approximate":
+            plan.reasons.append(
+                "近似解が求められたが、二部グラフのソルバーで厳密解の方が速く求まる"
+            )
+        plan.reasons.append(graph_desc)
+        plan.set(
+            "bipartite",
+            True,
+            "二部グラフなので、色ごとのマス数と最大マッチングでルートの勝敗が多項式時間で決まる",
+        )
+        plan.set("heuristic", False, "ルートで決着するので移動順序は使われない")
+        _set_exact_settings(plan, board)
+        plan.set("residual_cache", 0, "ルートで決着するので引かれない")
+        return plan
+
+    estimate_desc = ""
+    ordered = None
+    if goal == "auto":
+        # 厳密な探索の時間を、選ぶ設定（残余グラフのキャッシュ）で短い予算で見積もる
+        ordered = _estimate_exact(board, True, probe_seconds)
+        goal = "exact" if ordered.seconds <= time_limit else "approximate"
+        estimate_desc = (
+            f"厳密な探索の見積もり{format_seconds(ordered.seconds)}が"
+            f"制限{format_seconds(time_limit)}を{'超えない' if goal == 'exact' else '超える'}"
+        )
+
+    plan = SearchPlan(goal, game_length)
+    if estimate_desc:
+        plan.reasons.append(estimate_desc)
+    plan.reasons.append(graph_desc)
+    plan.set("bipartite", False, "二部グラフではない")
+    memory = _physical_memory()
+
+    if goal == "exact":
+        if ordered is None:
+            ordered = _estimate_exact(board, True, probe_seconds)
+        unordered = _estimate_exact(board, False, probe_seconds)
+        _choose_heuristic(plan, ordered, unordered)
+        _set_exact_settings(plan, board)
+        plan.set(
+            "residual_cache",
+            _RESIDUAL_VERTICES,
+            f"残余グラフが{_RESIDUAL_VERTICES}頂点以下になれば同型キャッシュで解く",
+        )
+        chosen = ordered if plan.settings["heuristic"] else unordered
+        table_bytes = chosen.nodes_high * _DICT_ENTRY_BYTES
+        if memory is not None and table_bytes > memory * _TABLE_MEMORY_FRACTION:
+            megabytes = memory * _TABLE_MEMORY_FRACTION / (1 << 20)
+            plan.set(
+                "compact_tt",
+                megabytes,
+                f"辞書の置換表が見積もりの上限で{table_bytes / (1 << 20):,.0f}MBになり、"
+                f"物理メモリの{_TABLE_MEMORY_FRACTION:.0%}を超える",
+            )
+        else:
+            plan.set(
+                "compact_tt",
+                None,
+                f"辞書の置換表が見積もりの上限でも{table_bytes / (1 << 20):,.0f}MBで、"
+                "差分テストで0.8倍程度遅いコンパクトな表はいらない",
+            )
+        return plan
+
+    # 近似解：分岐数から打ち切る深さを決める（分岐数が多いほど浅くする）
+    average_degree = 2 * info.num_edges / info.num_vertices
+    max_depth = max(
+        2,
+        min(board.len, int(_APPROXIMATE_DEPTH_BUDGET / max(1.0, average_degree))),
+    )
+    plan.set(
+        "max_depth",
+        max_depth,
+        f"平均分岐数{average_degree:.1f}から決めた深さ"
+        f"（{_APPROXIMATE_DEPTH_BUDGET} / 平均分岐数）",
+    )
+    num_playout = _APPROXIMATE_PLAYOUTS
+    plan.set(
+        "num_playout",
+        num_playout,
+        f"葉の勝率の標準誤差が最大{0.5 / math.sqrt(num_playout):.1%}になる回数",
+    )
+    plan.set(
+        "playout_policy",
+        _APPROXIMATE_PLAYOUT_POLICY,
+        "実験でwin-awareと同等以上の勝敗の正解率で、より速かった",
+    )
+    plan.set(
+        "exact_threshold",
+        0,
+        "厳密な勝率はrandom方策のプレイアウトの期待値なので、warnsdorff方策では使われない",
+    )
+    plan.set("tds", 0, "葉を評価する探索では使えない")
+
+    # 選んだ深さ、プレイアウト回数、方策で、移動順序の最適化の有無を見積もって比べる
+    original = board.num_playout, board.playout_policy
+    board.num_playout, board.playout_policy = num_playout, _APPROXIMATE_PLAYOUT_POLICY
+    try:
+        ordered = estimate_search(board, True, max_depth, None, probe_seconds)
+        unordered = estimate_search(board, False, max_depth, None, probe_seconds)
+    finally:
+        board.num_playout, board.playout_policy = original
+    _choose_heuristic(plan, ordered, unordered)
+
+    # 葉をまとめた1回の評価のプレイアウト回数が並列実行の下限以上になる場合だけ並列にする
+    cpus = os.cpu_count() or 1
+    batch_playouts = _APPROXIMATE_BATCH_SIZE * num_playout
+    if cpus > 1 and batch_playouts >= board.parallel_threshold:
+        parallel_desc = (
+            f"葉{_APPROXIMATE_BATCH_SIZE}個をまとめた1回のプレイアウト{batch_playouts:,}回が"
+            f"並列実行の下限{board.parallel_threshold:,}回以上"
+        )
+        plan.set("workers", cpus, f"利用できるCPUコア数（{parallel_desc}）")
+        plan.set("batch_size", _APPROXIMATE_BATCH_SIZE, parallel_desc)
+    else:
+        if cpus > 1:
+            serial_desc = (
+                f"葉{_APPROXIMATE_BATCH_SIZE}個をまとめてもプレイアウト{batch_playouts:,}回で、"
+                f"並列実行の下限{board.parallel_threshold:,}回に満たない"
+            )
+        else:
+            serial_desc = "利用できるCPUコアが1つ"
+        plan.set("workers", 1, serial_desc)
+        plan.set("batch_size", 0, serial_desc)
+
+    # 打ち切る深さでも到達可能なマスが多く残るなら、残余グラフのキャッシュは引かれない
+    remaining = board.get_reachable_mask().bit_count() - max_depth
+    if remaining + 1 > _RESIDUAL_VERTICES:
+        plan.set(
+            "residual_cache",
+            0,
+            f"深さ{max_depth}で打ち切っても到達可能なマスが最大{remaining}個残り、"
+            f"残余グラフが{_RESIDUAL_VERTICES}頂点以下にならない",
+        )
+    else:
+        plan.set(
+            "residual_cache",
+            _RESIDUAL_VERTICES,
+            f"深さ{max_depth}までに残余グラフが{_RESIDUAL_VERTICES}頂点以下になりうる",
+        )
+
+    # 近似値は勝敗だけを記録するコンパクトな表に入らないので、大きければ登録数に上限を設ける
+    table_bytes = (ordered if plan.settings["heuristic"] else unordered).nodes_high * (
+        _DICT_ENTRY_BYTES
+    )
+    if memory is not None and table_bytes > memory * _TABLE_MEMORY_FRACTION:
+        entries = int(memory * _TABLE_MEMORY_FRACTION / _DICT_ENTRY_BYTES)
+        plan.set(
+            "tt_entries",
+            entries,
+            f"辞書の置換表が見積もりの上限で{table_bytes / (1 << 20):,.0f}MBになり、"
+            f"物理メモリの{_TABLE_MEMORY_FRACTION:.0%}を超える",
+        )
+    return plan
+
+
+def estimate_game_length(board: Board, num_games: int) -> GameLength:
+    """両者が一様ランダムに手を選んだ場合の終局までの手数を見積もる
+
+    Args:
+        board (Board): チェスボードの状態（終わると元に戻す）
+        num_games (int): ランダムな対局の回数
+
+    Returns:
+        GameLength: 手数の平均と、その95%信頼区間
+    """
+    root_board, root_pos = board.get_state()
+    rng = random.Random(0)
+    lengths = []
+    for _ in range(num_games):
+        length = 0
+        while available_positions := board.get_available_positions():
+            board.make_move(rng.choice(available_positions))
+            length += 1
+        board.set_state(root_board, root_pos)
+        lengths.append(length)
+    mean = sum(lengths) / num_games
+    variance = sum((length - mean) ** 2 for length in lengths) / max(1, num_games - 1)
+    margin = CONFIDENCE_Z * math.sqrt(variance / num_games)
+    return GameLength(mean, max(0.0, mean - margin), mean + margin)
+
+
+def _estimate_exact(
+    board: Board, heuristic: bool, probe_seconds: float
+) -> SearchEstimate:
+    """残余グラフのキャッシュを使う厳密な探索を見積もる
+
+    Args:
+        board (Board): 探索を始めるチェスボードの状態
+        heuristic (bool): 移動順序の最適化を行うかどうか
+        probe_seconds (float): 見積もりのために探索する時間の上限（秒）
+
+    Returns:
+        SearchEstimate: 見積もり結果
+    """
+    set_residual_cache(ResidualCache(_RESIDUAL_VERTICES))
+    try:
+        return estimate_search(board, heuristic, board.len + 1, None, probe_seconds)
+    finally:
+        set_residual_cache(None)
+
+
+def _set_exact_settings(plan: SearchPlan, board: Board):
+    """厳密解に共通する設定を決める
+
+    Args:
+        plan (SearchPlan): 探索の設定
+        board (Board): 探索を始めるチェスボードの状態
+    """
+    plan.set("max_depth", board.len + 1, "厳密解なのでプレイアウトで打ち切らない")
+    plan.set("num_playout", 0, "プレイアウトを使わない")
+    plan.set("batch_size", 0, "葉の評価がないのでまとめる必要がない")
+    plan.set(
+        "tds",
+        0,
+        "差分テストでプロセス間のメッセージの分だけ逐次の探索の0.01〜0.12倍の速さだった",
+    )
+
+
+def _physical_memory() -> int | None:
+    """物理メモリのバイト数を返す（取得できなければNone）"""
+    try:
+        return os.sysconf("SC_PAGE_SIZE") * os.sysconf("SC_PHYS_PAGES")
+    except (AttributeError, OSError, ValueError):
+        return None
+
+
+def _choose_heuristic(
+    plan: SearchPlan, ordered: SearchEstimate, unordered: SearchEstimate
+):
+    """移動順序の最適化の有無を、見積もった探索時間の短い方に決める
+
+    Args:
+        plan (SearchPlan): 探索の設定
+        ordered (SearchEstimate): 移動順序の最適化ありの見積もり
+        unordered (SearchEstimate): 移動順序の最適化なしの見積もり
+    """
+    plan.set(
+        "heuristic",
+        ordered.seconds <= unordered.seconds,
+        f"見積もりが最適化ありで{ordered.nodes:,.0f}局面・{format_seconds(ordered.seconds)}、"
+        f"なしで{unordered.nodes:,.0f}局面・{format_seconds(unordered.seconds)}",
+    )
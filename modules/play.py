@@ -0,0 +1,262 @@
+"""対話的な対局
+
+勝敗が分かっている状態の表（状態キー -> 先手の勝利確率）を置換表として使い、エンジンの手は子局面の勝敗を表から引いて選ぶ。
+表は対局前に時間の予算の範囲で事前計算するか、ファイルから読み込む。
+表にない状態では時間を区切って探索し、ユーザーの手番の間も別スレッドで探索を続けて表を埋めていく（先読み）。
+
+厳密な探索で置換表に記録される値はすべて勝敗（1.0か0.0）なので、探索を途中で打ち切っても表の値は正しい。
+"""
+
+import copy
+import json
+import threading
+import time
+
+from .board import Board
+from .minimax import (
+    SearchAborted,
+    SearchProgress,
+    minimax,
+    set_search_progress,
+    set_transposition_table,
+)
+
+
+class SolvedStore:
+    def __init__(self, board: Board):
+        """勝敗が分かっている状態の表を初期化する
+
+        状態キーはボードのサイズ、駒の種類、正規化の方針で決まるので、それらを表の属性として記録する。
+
+        Args:
+            board (Board): 表を使うチェスボード
+        """
+        self.board_info = {
+            "size": list(board.size),
+            "piece": board.piece_type,
+            "canonical_max_depth": board.canonical_max_depth,
+            "canonical_min_empty": board.canonical_min_empty,
+        }
+        # 状態キー -> 先手の勝利確率（1.0か0.0）
+        self.results: dict[int, float] = {}
+
+    def load(self, path: str):
+        """表をファイルから読み込む
+
+        Args:
+            path (str): 表のファイルパス
+        """
+        with open(path) as f:
+            data = json.load(f)
+        if data["board"] != self.board_info:
+            raise ValueError("表のボードの設定が一致しません")
+        for key in data["wins"]:
+            self.results[int(key, 16)] = 1.0
+        for key in data["losses"]:
+            self.results[int(key, 16)] = 0.0
+
+    def save(self, path: str):
+        """表をファイルに書き出す
+
+        Args:
+            path (str): 表のファイルパス
+        """
+        data = {
+            "board": self.board_info,
+            "wins": sorted(f"{k:x}" for k, v in self.results.items() if v == 1.0),
+            "losses": sorted(f"{k:x}" for k, v in self.results.items() if v == 0.0),
+        }
+        with open(path, "w") as f:
+            json.dump(data, f, separators=(",", ":"))
+
+
+def solve_with_budget(
+    board: Board,
+    player: bool,
+    heuristic: bool,
+    time_budget: float | None,
+    progress: SearchProgress | None = None,
+) -> float | None:
+    """現在の状態を時間の予算の範囲で厳密に解く（結果は置換表に記録される）
+
+    Args:
+        board (Board): チェスボード（探索後に元の状態に戻す）
+        player (bool): 現在の手番（True: 先手, False: 後手）
+        heuristic (bool): 移動順序の最適化を行うかどうか
+        time_budget (float | None): 探索時間の予算（秒）
+        progress (SearchProgress | None): 中止に使う進捗（Noneなら作る）
+
+    Returns:
+        float | None: 先手の勝利確率（予算内に解けなければNone）
+    """
+    root_board, root_pos = board.get_state()
+    if progress is None:
+        progress = SearchProgress(None, time_budget)
+    set_search_progress(progress)
+    try:
+        result, _ = minimax(board, 0, player, False, heuristic, board.len + 1, 0.0, 1.0)
+        return result
+    except SearchAborted:
+        return None
+    finally:
+        set_search_progress(None)
+        board.set_state(root_board, root_pos)
+
+
+class Ponderer:
+    def __init__(self, board: Board, heuristic: bool):
+        """ユーザーの手番の間に別スレッドで探索を続ける先読みを初期化する
+
+        Args:
+            board (Board): 先読みするチェスボード（複製して使う）
+            heuristic (bool): 移動順序の最適化を行うかどうか
+        """
+        self.board = copy.deepcopy(board)
+        self.heuristic = heuristic
+        self.progress = SearchProgress(None, None)
+        self._thread = threading.Thread(target=self._run, daemon=True)
+
+    def start(self):
+        """先読みを始める"""
+        self._thread.start()
+
+    def stop(self) -> int:
+        """先読みを止める
+
+        Returns:
+            int: 先読みで探索した局面数
+        """
+        self.progress.stop()
+        self._thread.join()
+        return self.progress.nodes
+
+    def _run(self):
+        player = self.board.get_current_player()
+        solve_with_budget(self.board, player, self.heuristic, None, self.progress)
+
+
+def lookup_children(board: Board, store: SolvedStore) -> dict[int, float | None]:
+    """各合法手の後の状態の先手の勝利確率を表から引く
+
+    Args:
+        board (Board): チェスボード
+        store (SolvedStore): 勝敗が分かっている状態の表
+
+    Returns:
+        dict[int, float | None]: 手 -> 先手の勝利確率（表になければNone）
+    """
+    values: dict[int, float | None] = {}
+    for move in board.get_available_positions():
+        original_pos = board.make_move(move)
+        values[move] = store.results.get(board.get_state_key())
+        board.undo_move(move, original_pos)
+    return values
+
+
+def choose_move(
+    board: Board,
+    store: SolvedStore,
+    heuristic: bool,
+    think_seconds: float,
+) -> tuple[int, float | None, bool]:
+    """エンジンの手を選ぶ
+
+    勝てる手が表にあればそれを選ぶ。なければthink_secondsまで探索してから選び直し、
+    それでも勝てる手が分からなければ、負けと分かっていない手を優先して選ぶ。
+
+    Args:
+        board (Board): チェスボード（合法手があること）
+        store (SolvedStore): 勝敗が分かっている状態の表
+        heuristic (bool): 移動順序の最適化を行うかどうか
+        think_seconds (float): 表にない場合に探索する時間の上限（秒）
+
+    Returns:
+        tuple[int, float | None, bool]: (手, その後の先手の勝利確率（不明ならNone）, 探索したかどうか)
+    """
+    player = board.get_current_player()
+    winning = 1.0 if player else 0.0
+    values = lookup_children(board, store)
+    searched = False
+    if winning not in values.values() and None in values.values():
+        solve_with_budget(board, player, heuristic, think_seconds)
+        values = lookup_children(board, store)
+        searched = True
+
+    for preferred in (winning, None, 1.0 - winning):
+        for move, value in values.items():
+            if value == preferred:
+                return move, value, searched
+    raise ValueError("合法手がありません")
+
+
+def parse_move(text: str, board: Board) -> int | None:
+    """「行 列」の入力を位置インデックスにする（合法手でなければNone）"""
+    parts = text.replace(",", " ").split()
+    if len(parts) != 2 or not all(p.isdigit() for p in parts):
+        return None
+    row, col = map(int, parts)
+    if not (0 <= row < board.size[0] and 0 <= col < board.size[1]):
+        return None
+    position = board.index_map[(row, col)]
+    return position if position in board.get_available_positions() else None
+
+
+def play(
+    board: Board,
+    store: SolvedStore,
+    human_first: bool,
+    heuristic: bool,
+    think_seconds: float,
+):
+    """ユーザーとエンジンで対局する
+
+    Args:
+        board (Board): 対局を始めるチェスボードの状態
+        store (SolvedStore): 勝敗が分かっている状態の表
+        human_first (bool): ユーザーが先手かどうか
+        heuristic (bool): 移動順序の最適化を行うかどうか
+        think_seconds (float): 表にない場合にエンジンが探索する時間の上限（秒）
+    """
+    set_transposition_table(store.results)
+    width = board.size[1]
+    while True:
+        player = board.get_current_player()
+        if not board.get_available_positions():
+            winner = "ユーザー" if player != human_first else "エンジン"
+            print(f"{'先手' if player else '後手'}は動けません。{winner}の勝ちです")
+            return
+
+        if player == human_first:
+            # ユーザーが考えている間に先読みする
+            ponderer = Ponderer(board, heuristic)
+            ponderer.start()
+            while True:
+                text = input("あなたの手（行 列、qで終了）: ").strip()
+                if text == "q":
+                    ponderer.stop()
+                    return
+                move = parse_move(text, board)
+                if move is not None:
+                    break
+                print("合法手ではありません")
+            nodes = ponderer.stop()
+            print(f"先読み: {nodes:,}局面, 表の登録数 {len(store.results):,}")
+            board.make_move(move)
+            board.print_board()
+            continue
+
+        start = time.perf_counter()
+        move, value, searched = choose_move(board, store, heuristic, think_seconds)
+        elapsed = time.perf_counter() - start
+        if value is None:
+            evaluation = "不明"
+        else:
+            evaluation = (
+                "エンジンの勝ち" if (value == 1.0) == player else "エンジンの負け"
+            )
+        print(
+            f"エンジンの手: ({move // width},{move % width}) 評価: {evaluation} "
+            f"({'探索' if searched else '参照'} {elapsed * 1000:.3f}ms)"
+        )
+        board.make_move(move)
+        board.print_board()
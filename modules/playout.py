@@ -0,0 +1,129 @@
+"""プレイアウトで手を選ぶ方策と並列実行用のワーカー関数の定義
+
+各方策は (board, visited, moves) を受け取り、移動先の位置インデックスを返す。
+visitedはプレイアウト中の盤面のビット表現、movesは移動可能かつ未訪問の位置のビットマスク（0以外）である。
+"""
+
+import random
+from collections.abc import Callable
+from typing import TYPE_CHECKING
+
+if TYPE_CHECKING:
+    from .board import Board
+
+
+def _pick_random_bit(mask: int, board: "Board") -> int:
+    """ビットマスク中の1のビットを一様ランダムに1つ選ぶ
+
+    Args:
+        mask (int): 候補の位置のビットマスク（0以外）
+        board (Board): 乱数生成器を持つチェスボード
+
+    Returns:
+        int: 選ばれた位置インデックス
+    """
+    k = board.rng.randrange(mask.bit_count())
+    for _ in range(k):
+        # 最下位の1を消す
+        mask &= mask - 1
+    return (mask & -mask).bit_length() - 1
+
+
+def random_policy(board: "Board", visited: int, moves: int) -> int:
+    """一様ランダムに手を選ぶ"""
+    return _pick_random_bit(moves, board)
+
+
+def warnsdorff_policy(board: "Board", visited: int, moves: int) -> int:
+    """移動後に相手が動ける手の数（onward degree）が最小の手を選ぶ
+
+    同点の手が複数ある場合はその中からランダムに選ぶ。
+    """
+    moves_map = board.available_positions_map
+    best, best_degree = 0, board.len + 1
+    rest = moves
+    while rest:
+        low = rest & -rest
+        rest ^= low
+        degree = (moves_map[low.bit_length() - 1] & ~(visited | low)).bit_count()
+        if degree < best_degree:
+            best, best_degree = low, degree
+        elif degree == best_degree:
+            best |= low
+    return _pick_random_bit(best, board)
+
+
+def epsilon_greedy_policy(board: "Board", visited: int, moves: int) -> int:
+    """確率epsilonでランダムに、それ以外はmobility_mapが最小の手を選ぶ
+
+    mobility_mapは訪問状況を無視した静的な値なので、warnsdorffより安価に計算できる。
+    """
+    if board.rng.random() < board.playout_epsilon:
+        return _pick_random_bit(moves, board)
+
+    mobility_map = board.mobility_map
+    best, best_mobility = 0, board.len + 1
+    rest = moves
+    while rest:
+        low = rest & -rest
+        rest ^= low
+        mobility = mobility_map[low.bit_length() - 1]
+        if mobility < best_mobility:
+            best, best_mobility = low, mobility
+        elif mobility == best_mobility:
+            best |= low
+    return _pick_random_bit(best, board)
+
+
+def win_aware_policy(board: "Board", visited: int, moves: int) -> int:
+    """相手が動けなくなる手（即勝ちの手）があればそれを選び、なければランダムに選ぶ"""
+    moves_map = board.available_positions_map
+    rest = moves
+    while rest:
+        low = rest & -rest
+        rest ^= low
+        i = low.bit_length() - 1
+        if not moves_map[i] & ~(visited | low):
+            return i
+    return _pick_random_bit(moves, board)
+
+
+# 方策名から方策関数を引けるようにする
+PLAYOUT_POLICIES: dict[str, Callable[["Board", int, int], int]] = {
+    "random": random_policy,
+    "warnsdorff": warnsdorff_policy,
+    "epsilon-greedy": epsilon_greedy_policy,
+    "win-aware": win_aware_policy,
+}
+
+
+# ワーカープロセス内で使うチェスボード（init_playout_workerで設定される）
+_worker_board: "Board | None" = None
+
+
+def init_playout_worker(board: "Board"):
+    """ワーカープロセスの初期化時にチェスボードの複製を保持する
+
+    Args:
+        board (Board): 親プロセスのチェスボード
+    """
+    global _worker_board
+    _worker_board = board
+
+
+def run_playouts_in_worker(task: tuple[int, int, bool, int, int]) -> int:
+    """ワーカープロセス内でプレイアウトを行い、先手が勝った回数を返す
+
+    Args:
+        task (tuple[int, int, bool, int, int]): (盤面, 駒の位置, 手番, 乱数シード, プレイアウト回数)
+
+    Returns:
+        int: 先手が勝った回数
+    """
+    assert _worker_board is not None
+    board, position, current_player, seed, num_playout = task
+    # タスクごとにシードから独立した乱数列を作る
+    _worker_board.rng = random.Random(seed)
+    return _worker_board.count_playout_wins(
+        board, position, current_player, num_playout
+    )
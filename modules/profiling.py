@@ -0,0 +1,183 @@
+"""探索のプロファイリング
+
+cProfileで関数ごとの時間を計測してpstats形式で書き出し、同時に別スレッドから探索中のスタックを一定間隔で
+サンプリングしてcollapsed stack形式（flamegraph用）で書き出す。
+計測後は、サンプルから正規化・移動生成・置換表・プレイアウトなどの処理ごとの時間の内訳を求めて表示する。
+
+サンプリングのスレッドはGILを取れたときにしか動けないため、計測中はスレッドの切り替え間隔をサンプリングの間隔に合わせる。
+"""
+
+import cProfile
+import os
+import pstats
+import sys
+import threading
+from collections.abc import Callable
+from typing import TypeVar
+
+T = TypeVar("T")
+
+# 処理の分類 -> (ファイル名, 関数名) の集合（関数名がNoneならファイル内のすべての関数）
+HOT_CATEGORIES: dict[str, set[tuple[str, str | None]]] = {
+    "正規化": {("board.py", "get_canonical_state"), ("board.py", "get_state_key")},
+    "移動生成": {
+        ("board.py", "get_available_positions"),
+        ("board.py", "get_reachable_mask"),
+        ("board.py", "make_move"),
+        ("board.py", "undo_move"),
+    },
+    "移動順序": {("minimax.py", "_sort_moves_by_heuristic"), ("minimax.py", "score")},
+    "置換表": {("ttable.py", None)},
+    "プレイアウト": {
+        ("playout.py", None),
+        ("board.py", "get_playout_result"),
+        ("board.py", "get_playout_results"),
+        ("board.py", "count_playout_wins"),
+        ("board.py", "get_random_play_result"),
+    },
+    "静的評価": {("evaluation.py", None)},
+    "残余グラフ": {("residual.py", None)},
+}
+
+
+class StackSampler:
+    def __init__(self, interval: float):
+        """スタックのサンプラーを初期化する
+
+        Args:
+            interval (float): サンプリングの間隔（秒）
+        """
+        self.interval = interval
+        # スタック（呼び出し元から順の「ファイル名:関数名」） -> サンプル数
+        self.counts: dict[tuple[str, ...], int] = {}
+        self._target = threading.get_ident()
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+
+    def start(self):
+        """呼び出したスレッドのサンプリングを始める"""
+        self._target = threading.get_ident()
+        self._thread.start()
+
+    def stop(self):
+        """サンプリングを終える"""
+        self._stop.set()
+        self._thread.join()
+
+    def _run(self):
+        while not self._stop.wait(self.interval):
+            frame = sys._current_frames().get(self._target)
+            stack: list[str] = []
+            while frame is not None:
+                code = frame.f_code
+                stack.append(f"{os.path.basename(code.co_filename)}:{code.co_name}")
+                frame = frame.f_back
+            key = tuple(reversed(stack))
+            self.counts[key] = self.counts.get(key, 0) + 1
+
+    def write_collapsed(self, path: str):
+        """サンプルをcollapsed stack形式でファイルに書き出す
+
+        各行は「関数1;関数2;... サンプル数」の形式で、flamegraph.plなどにそのまま渡せる。
+
+        Args:
+            path (str): 出力先のファイルパス
+        """
+        with open(path, "w") as f:
+            f.writelines(
+                f"{';'.join(stack)} {count}\n"
+                for stack, count in sorted(self.counts.items())
+            )
+
+
+def profile_call(
+    func: Callable[[], T], prefix: str, interval: float
+) -> tuple[T, pstats.Stats, StackSampler]:
+    """関数をプロファイラの下で実行し、結果をファイルに書き出す
+
+    prefix + ".pstats"にpstats形式の統計を、prefix + ".collapsed"にcollapsed stack形式のサンプルを書き出す。
+
+    Args:
+        func (Callable[[], T]): 実行する関数
+        prefix (str): 出力先のファイルパスの接頭辞
+        interval (float): スタックのサンプリングの間隔（秒）
+
+    Returns:
+        tuple[T, pstats.Stats, StackSampler]: (関数の戻り値, 統計, スタックのサンプル)
+    """
+    profiler = cProfile.Profile()
+    sampler = StackSampler(interval)
+    switch_interval = sys.getswitchinterval()
+    sys.setswitchinterval(interval)
+    sampler.start()
+    profiler.enable()
+    try:
+        result = func()
+    finally:
+        profiler.disable()
+        sampler.stop()
+        sys.setswitchinterval(switch_interval)
+    profiler.dump_stats(prefix + ".pstats")
+    sampler.write_collapsed(prefix + ".collapsed")
+    return result, pstats.Stats(profiler), sampler
+
+
+def _categorize(frame: str) -> str | None:
+    """「ファイル名:関数名」のフレームが属する処理の分類を返す（どれにも属さなければNone）"""
+    filename, _, name = frame.partition(":")
+    for category, functions in HOT_CATEGORIES.items():
+        if (filename, name) in functions or (filename, None) in functions:
+            return category
+    return None
+
+
+def print_hot_summary(stats: pstats.Stats, sampler: StackSampler, top: int = 10):
+    """処理の分類ごとの時間の割合と、自身の時間が長い関数を表示する
+
+    分類ごとの割合は、スタックのサンプルを最も内側の分類に属するフレームの分類に割り当てて求める。
+    分類から呼ばれた組み込み関数なども分類に含まれ、入れ子の分類で重複して数えることもない。
+    ただし、辞書の置換表の参照は組み込み関数なのでスタックに現れない。
+    そこで、探索関数から呼ばれたdict.getの時間の割合を統計から求め、「その他」から「置換表」に移す。
+
+    Args:
+        stats (pstats.Stats): プロファイルの統計
+        sampler (StackSampler): スタックのサンプル
+        top (int): 表示する関数の数
+    """
+    entries = stats.stats  # type: ignore[attr-defined]
+    total = sum(tt for _, _, tt, _, _ in entries.values())
+    if total <= 0.0:
+        return
+
+    num_samples = sum(sampler.counts.values())
+    if num_samples > 0:
+        ratios = dict.fromkeys([*HOT_CATEGORIES, "その他"], 0.0)
+        for stack, count in sampler.counts.items():
+            category = next(
+                (c for c in map(_categorize, reversed(stack)) if c is not None),
+                "その他",
+            )
+            ratios[category] += count / num_samples
+        dict_get = entries.get(("~", 0, "<method 'get' of 'dict' objects>"))
+        if dict_get is not None:
+            tt_ratio = (
+                sum(
+                    tt
+                    for (filename, _, name), (_, _, tt, _) in dict_get[4].items()
+                    if os.path.basename(filename) == "minimax.py"
+                    and name in ("minimax", "_minimax_coroutine")
+                )
+                / total
+            )
+            tt_ratio = min(tt_ratio, ratios["その他"])
+            ratios["置換表"] += tt_ratio
+            ratios["その他"] -= tt_ratio
+        print(f"処理ごとの時間の割合（サンプル数 {num_samples:,}）")
+        for category, ratio in ratios.items():
+            print(f"  {ratio:7.1%}  {category}")
+
+    print(f"自身の時間が長い関数（上位{top}件）")
+    ranked = sorted(entries.items(), key=lambda item: item[1][2], reverse=True)
+    for (filename, line, name), (_, calls, tt, _, _) in ranked[:top]:
+        location = f"{os.path.basename(filename)}:{line}({name})"
+        print(f"  {tt:9.3f}秒 {tt / total:7.1%} {calls:12,d}回  {location}")
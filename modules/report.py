@@ -0,0 +1,103 @@
+"""探索の手順ごとの内訳の記録
+
+ルートからの手順（移動先の列）ごとに、局面数・置換表ヒット数・時間・結果を記録する。
+ルートの手と2手目までは表として、より深い手順は局面数を集約したcollapsed stack形式（flamegraph用）として出力する。
+"""
+
+import time
+
+# 表に出す手順の深さ
+_TABLE_DEPTH = 2
+
+
+class MoveStats:
+    def __init__(self):
+        """手順1つ分の内訳を初期化する"""
+        self.nodes = 0
+        self.tt_hits = 0
+        self.seconds = 0.0
+        self.result: float | None = None
+
+
+class SearchReport:
+    def __init__(self, width: int, collapsed_depth: int):
+        """探索の手順ごとの内訳の記録を初期化する
+
+        Args:
+            width (int): ボードの横のサイズ（手の表示に使う）
+            collapsed_depth (int): collapsed stackで区別する手順の深さの上限
+        """
+        self.width = width
+        self.collapsed_depth = collapsed_depth
+        self.path: list[int] = []
+        self._starts: list[float] = []
+        # 手順 -> 内訳（ルートの手と2手目まで）
+        self.moves: dict[tuple[int, ...], MoveStats] = {}
+        # 手順 -> その手順で数えた局面数（collapsed_depthより深い局面は切り詰めた手順に集約）
+        self.collapsed: dict[tuple[int, ...], int] = {}
+
+    def push(self, position: int):
+        """手を進める
+
+        Args:
+            position (int): 移動先の位置インデックス
+        """
+        self.path.append(position)
+        if len(self.path) <= _TABLE_DEPTH:
+            self._starts.append(time.perf_counter())
+
+    def pop(self, result: float, nodes: int):
+        """手を戻し、その手以下の探索結果を記録する
+
+        Args:
+            result (float): その手の後の局面の先手の勝利確率
+            nodes (int): その手以下で数えた局面数
+        """
+        if len(self.path) <= _TABLE_DEPTH:
+            stats = self.moves.setdefault(tuple(self.path), MoveStats())
+            stats.seconds += time.perf_counter() - self._starts.pop()
+            stats.nodes += nodes
+            stats.result = result
+        self.path.pop()
+
+    def count_node(self):
+        """現在の手順で局面を1つ数える"""
+        key = tuple(self.path[: self.collapsed_depth])
+        self.collapsed[key] = self.collapsed.get(key, 0) + 1
+
+    def count_tt_hit(self):
+        """現在の手順で置換表ヒットを1つ数える"""
+        for depth in range(1, min(len(self.path), _TABLE_DEPTH) + 1):
+            stats = self.moves.setdefault(tuple(self.path[:depth]), MoveStats())
+            stats.tt_hits += 1
+
+    def format_move(self, position: int) -> str:
+        """位置インデックスを「(行,列)」の文字列にする"""
+        return f"({position // self.width},{position % self.width})"
+
+    def print_table(self):
+        """ルートの手と2手目ごとの内訳を表示する（探索した順）"""
+        print("手順           結果(先手勝率)      局面数  置換表ヒット      時間")
+        for path, stats in self.moves.items():
+            if stats.result is None:
+                # 置換表ヒットだけが記録され、手として探索しなかった
+                continue
+            label = " ".join(self.format_move(p) for p in path)
+            indent = "  " * (len(path) - 1)
+            print(
+                f"{indent + label:14s} {stats.result:14.2%} {stats.nodes:12,d} "
+                f"{stats.tt_hits:12,d} {stats.seconds:8.3f}秒"
+            )
+
+    def write_collapsed(self, path: str):
+        """手順ごとの局面数をcollapsed stack形式でファイルに書き出す
+
+        各行は「root;手1;手2;... 局面数」の形式で、flamegraph.plなどにそのまま渡せる。
+
+        Args:
+            path (str): 出力先のファイルパス
+        """
+        with open(path, "w") as f:
+            for moves, count in sorted(self.collapsed.items()):
+                frames = ["root", *(self.format_move(p) for p in moves)]
+                f.write(f"{';'.join(frames)} {count}\n")
@@ -0,0 +1,295 @@
+"""終盤の残余グラフの同型キャッシュ
+
+終盤では、駒の位置から未訪問のマスだけを辿って到達できるマス（残余グラフ）だけが勝敗に関係する。
+残余グラフの頂点に正準なラベル付けを行ってキーとすることで、
+盤面の対称変換では同一視できない局面や、異なるボードサイズ・駒の局面でも結果を共有できる。
+"""
+
+import argparse
+import json
+
+from .board import Board
+
+# 正準ラベル付けで調べる葉の数の上限（これを超えるグラフはキャッシュしない）
+_CANONICAL_SEARCH_LIMIT = 1024
+# キーの下位5bitに頂点数を入れるので、キャッシュできる頂点数の上限は31
+MAX_RESIDUAL_VERTICES = 31
+
+
+def extract_residual_graph(board: Board) -> list[int]:
+    """現在の局面の残余グラフを取り出す
+
+    頂点0が駒の位置、頂点1以降が到達可能な未訪問のマス（インデックス順）となる。
+    隣接は対称で、駒の位置に隣接するマスの隣接にも頂点0を含める（正準なラベル付けは対称な隣接を前提とする）。
+
+    Args:
+        board (Board): 現在のチェスボードの状態
+
+    Returns:
+        list[int]: 各頂点に隣接する頂点のビットマスクのリスト
+    """
+    reachable = board.get_reachable_mask()
+    squares = [board.pos]
+    rest = reachable
+    while rest:
+        low = rest & -rest
+        rest ^= low
+        squares.append(low.bit_length() - 1)
+
+    # マスのインデックスから頂点番号を引けるようにする
+    vertex_of = {square: v for v, square in enumerate(squares)}
+    adj: list[int] = []
+    piece_bit = 1 << board.pos
+    for square in squares:
+        neighbors = board.available_positions_map[square]
+        # 駒の位置は訪問済みなので、reachableとは別に頂点0への辺を加える
+        mask = 1 if square != board.pos and neighbors & piece_bit else 0
+        neighbors &= reachable
+        while neighbors:
+            low = neighbors & -neighbors
+            neighbors ^= low
+            mask |= 1 << vertex_of[low.bit_length() - 1]
+        adj.append(mask)
+    return adj
+
+
+def canonical_key(adj: list[int]) -> int | None:
+    """駒の頂点（頂点0）を区別した残余グラフの正準なキーを返す
+
+    次数による分割の細分化と、分割しきれないセルの頂点を1つずつ固定する探索により正準な頂点順を求め、
+    その順での隣接行列の上三角を最小にするものをキーとする。
+
+    Args:
+        adj (list[int]): 各頂点に隣接する頂点のビットマスクのリスト
+
+    Returns:
+        int | None: 正準なキー（探索が上限を超えた場合はNone）
+    """
+    n = len(adj)
+    cells = [[0], list(range(1, n))] if n > 1 else [[0]]
+    best: list[int | None] = [None]
+    budget = [_CANONICAL_SEARCH_LIMIT]
+
+    def search(cells: list[list[int]]) -> bool:
+        cells = _refine(adj, cells)
+        k = next((i for i, cell in enumerate(cells) if len(cell) > 1), -1)
+        if k == -1:
+            budget[0] -= 1
+            code = _encode(adj, [cell[0] for cell in cells])
+            if best[0] is None or code < best[0]:
+                best[0] = code
+            return budget[0] > 0
+
+        cell = cells[k]
+        # セル内の頂点が互いに双子（相手を除いた隣接が同じ）なら、どれを固定しても同じ結果になる
+        first = cell[0]
+        if all(adj[first] & ~(1 << v) == adj[v] & ~(1 << first) for v in cell[1:]):
+            candidates = [first]
+        else:
+            candidates = cell
+        for v in candidates:
+            rest = [u for u in cell if u != v]
+            if not search(cells[:k] + [[v], rest] + cells[k + 1 :]):
+                return False
+        return True
+
+    if not search(cells):
+        return None
+    assert best[0] is not None
+    assert n <= MAX_RESIDUAL_VERTICES
+    # 頂点数を下位ビットに入れて、頂点数の異なるグラフを区別する
+    return (best[0] << 5) | n
+
+
+def _refine(adj: list[int], cells: list[list[int]]) -> list[list[int]]:
+    """各セルの頂点を、各セルへの隣接数で安定するまで分割する
+
+    Args:
+        adj (list[int]): 各頂点に隣接する頂点のビットマスクのリスト
+        cells (list[list[int]]): 頂点の順序付き分割
+
+    Returns:
+        list[list[int]]: 細分化された分割
+    """
+    while True:
+        masks = [sum(1 << v for v in cell) for cell in cells]
+        new_cells: list[list[int]] = []
+        for cell in cells:
+            if len(cell) == 1:
+                new_cells.append(cell)
+                continue
+            groups: dict[tuple[int, ...], list[int]] = {}
+            for v in cell:
+                signature = tuple((adj[v] & m).bit_count() for m in masks)
+                groups.setdefault(signature, []).append(v)
+            new_cells.extend(groups[signature] for signature in sorted(groups))
+        if len(new_cells) == len(cells):
+            return new_cells
+        cells = new_cells
+
+
+def _encode(adj: list[int], order: list[int]) -> int:
+    """与えられた頂点順での隣接行列の上三角を整数にする
+
+    Args:
+        adj (list[int]): 各頂点に隣接する頂点のビットマスクのリスト
+        order (list[int]): 頂点の並び
+
+    Returns:
+        int: 隣接行列の上三角のビット列
+    """
+    code = 0
+    for i, u in enumerate(order):
+        for v in order[i + 1 :]:
+            code = (code << 1) | ((adj[u] >> v) & 1)
+    return code
+
+
+def solve_residual(adj: list[int]) -> bool:
+    """残余グラフ上のゲームを解き、手番のプレイヤーが勝つかどうかを返す
+
+    Args:
+        adj (list[int]): 各頂点に隣接する頂点のビットマスクのリスト（頂点0が駒の位置）
+
+    Returns:
+        bool: 手番のプレイヤーが勝つならTrue
+    """
+    memo: dict[tuple[int, int], bool] = {}
+
+    def wins(v: int, unvisited: int) -> bool:
+        key = (v, unvisited)
+        if key in memo:
+            return memo[key]
+        result = False
+        moves = adj[v] & unvisited
+        while moves:
+            low = moves & -moves
+            moves ^= low
+            # 相手が負ける移動先があれば勝ち
+            if not wins(low.bit_length() - 1, unvisited ^ low):
+                result = True
+                break
+        memo[key] = result
+        return result
+
+    return wins(0, ((1 << len(adj)) - 1) & ~1)
+
+
+class ResidualCache:
+    def __init__(self, max_vertices: int):
+        """残余グラフの同型キャッシュを初期化する
+
+        Args:
+            max_vertices (int): キャッシュを使う残余グラフの頂点数（駒の位置を含む）の上限
+        """
+        if not 0 < max_vertices <= MAX_RESIDUAL_VERTICES:
+            raise ValueError(
+                f"残余グラフの頂点数の上限は1以上{MAX_RESIDUAL_VERTICES}以下で指定してください"
+            )
+        self.max_vertices = max_vertices
+        # 正準なキー -> 手番のプレイヤーが勝つか
+        self.table: dict[int, bool] = {}
+        self.hits = 0
+        self.misses = 0
+
+    def lookup(self, board: Board) -> bool | None:
+        """現在の局面の勝敗をキャッシュから引く（なければ残余グラフを解いて登録する）
+
+        Args:
+            board (Board): 現在のチェスボードの状態
+
+        Returns:
+            bool | None: 手番のプレイヤーが勝つならTrue（残余グラフが大きすぎる場合はNone）
+        """
+        if board.get_reachable_mask().bit_count() + 1 > self.max_vertices:
+            return None
+        adj = extract_residual_graph(board)
+        key = canonical_key(adj)
+        if key is None:
+            return None
+        if key in self.table:
+            self.hits += 1
+            return self.table[key]
+        self.misses += 1
+        result = solve_residual(adj)
+        self.table[key] = result
+        return result
+
+    def load(self, path: str):
+        """事前計算した表をファイルから読み込む
+
+        Args:
+            path (str): 表のファイルパス
+        """
+        with open(path) as f:
+            data = json.load(f)
+        for key in data["wins"]:
+            self.table[int(key, 16)] = True
+        for key in data["losses"]:
+            self.table[int(key, 16)] = False
+
+    def save(self, path: str):
+        """表をファイルに書き出す
+
+        Args:
+            path (str): 表のファイルパス
+        """
+        data = {
+            "wins": sorted(f"{k:x}" for k, v in self.table.items() if v),
+            "losses": sorted(f"{k:x}" for k, v in self.table.items() if not v),
+        }
+        with open(path, "w") as f:
+            json.dump(data, f, separators=(",", ":"))
+
+
+def build_residual_table(max_vertices: int) -> ResidualCache:
+    """頂点数がmax_vertices以下のすべての連結な残余グラフについて勝敗の表を作る
+
+    頂点0を駒の位置として、すべての辺の組み合わせを列挙する。
+
+    Args:
+        max_vertices (int): 頂点数の上限
+
+    Returns:
+        ResidualCache: 表を登録したキャッシュ
+    """
+    cache = ResidualCache(max_vertices)
+    for n in range(1, max_vertices + 1):
+        pairs = [(i, j) for i in range(n) for j in range(i + 1, n)]
+        for edges in range(1 << len(pairs)):
+            adj = [0] * n
+            for b, (i, j) in enumerate(pairs):
+                if (edges >> b) & 1:
+                    adj[i] |= 1 << j
+                    adj[j] |= 1 << i
+            if not _is_connected(adj):
+                continue
+            key = canonical_key(adj)
+            if key is not None and key not in cache.table:
+                cache.table[key] = solve_residual(adj)
+    return cache
+
+
+def _is_connected(adj: list[int]) -> bool:
+    """頂点0からすべての頂点に到達できるかどうかを判定する"""
+    reached = 1
+    frontier = 1
+    while frontier:
+        next_frontier = 0
+        while frontier:
+            low = frontier & -frontier
+            frontier ^= low
+            next_frontier |= adj[low.bit_length() - 1]
+        frontier = next_frontier & ~reached
+        reached |= frontier
+    return reached == (1 << len(adj)) - 1
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="残余グラフの勝敗表の事前計算")
+    parser.add_argument("max_vertices", type=int, help="頂点数の上限")
+    parser.add_argument("output", type=str, help="出力先のファイルパス")
+    args = parser.parse_args()
+    table = build_residual_table(args.max_vertices)
+    table.save(args.output)
+    print(f"{len(table.table):,}個の残余グラフを登録しました")
@@ -0,0 +1,262 @@
+"""置換表を分割したtransposition-driven scheduling（TDS）による厳密な探索
+
+各ワーカーは状態キー（Board.get_state_key）の空間の一部（シャード）を受け持ち、その置換表だけを持つ。
+局面を解く仕事は局面のキーを受け持つワーカーへ送られるので、置換表の参照はすべてワーカー内で完結し、
+置換表のメモリはワーカー数に比例して分散される。対称な局面は同じキーになるので、同じワーカーで一度だけ解かれる。
+
+ワーカー間では次のメッセージを送る（宛先ごとにまとめてキューに入れる）。
+
+- ("solve", キー, 盤面, 駒の位置, 返信先): 局面を解く。返信先は (ワーカー番号, 親のキー)（ルートは (-1, 0)）
+- ("result", 親のキー, 手番が勝つか): 子局面の結果を親の局面を受け持つワーカーへ返す
+
+局面を展開すると、まず相手の動ける手が最も少ない子局面だけを担当へ送り、その子局面で勝てなかった場合に
+残りの子局面をまとめて送る（young brothers wait）。手番が負ける子局面が見つかった時点で勝ち、
+すべての子局面で手番が勝てば負けと確定して、待っている返信先へ結果を送る。
+解いている途中の局面に別の親から仕事が来た場合は返信先に加えるだけで、同じ局面を二度展開しない。
+勝ちが確定した後も送り済みの兄弟の子局面の探索は続く（投機的な探索）ため、逐次のalpha-beta探索より局面数は増える。
+
+ワーカーはmultiprocessingのプロセスで、通信はmultiprocessing.Queueで行う。
+"""
+
+import multiprocessing
+import queue
+from multiprocessing.queues import Queue
+from typing import NamedTuple
+
+from .board import Board
+from .ttable import TwoLevelTranspositionTable
+
+# ワーカーがキューを確認するまでに処理するメッセージ数
+_MESSAGES_PER_FLUSH = 256
+
+
+class ShardStats(NamedTuple):
+    """ワーカー1つ分の探索の統計"""
+
+    expanded: int  # 展開した局面数
+    table_size: int  # 置換表の登録数
+    hits: int  # 置換表か解いている途中の局面で済んだ仕事の数
+    l1_hits: int  # 置換表の参照のうちL1で済んだ数（L1を置かなければ0）
+    local_messages: int  # 自分宛てのメッセージ数
+    remote_messages: int  # 他のワーカー宛てのメッセージ数
+
+
+def shard_of(key: int, num_shards: int) -> int:
+    """状態キーを受け持つシャードの番号を返す
+
+    キーの下位ビットは盤面の特定のマスに対応して偏るので、乗算ハッシュで混ぜてから割り当てる。
+
+    Args:
+        key (int): 状態キー
+        num_shards (int): シャード数
+
+    Returns:
+        int: シャードの番号
+    """
+    mixed = ((hash(key) * 0x9E3779B97F4A7C15) & 0xFFFFFFFFFFFFFFFF) >> 32
+    return mixed % num_shards
+
+
+def solve_sharded(
+    board: Board, num_workers: int, l1_entries: int = 0
+) -> tuple[bool, list[ShardStats]]:
+    """置換表をワーカーごとに分割して、現在の局面で手番のプレイヤーが勝つかを厳密に求める
+
+    葉を評価せずに最後まで解くので、移動順序の最適化や深さの制限は使わない。
+
+    Args:
+        board (Board): 現在のチェスボードの状態
+        num_workers (int): ワーカープロセス数
+        l1_entries (int): 各ワーカーの置換表の前に置くL1のスロット数（0なら置かない）
+
+    Returns:
+        tuple[bool, list[ShardStats]]: (手番のプレイヤーが勝つか, ワーカーごとの統計)
+    """
+    if num_workers < 1:
+        raise ValueError("ワーカー数は1以上で指定してください")
+    inboxes: list[Queue] = [multiprocessing.Queue() for _ in range(num_workers)]
+    results: Queue = multiprocessing.Queue()
+    workers = [
+        multiprocessing.Process(
+            target=_run_shard,
+            args=(board, i, inboxes, results, l1_entries),
+            daemon=True,
+        )
+        for i in range(num_workers)
+    ]
+    for worker in workers:
+        worker.start()
+
+    try:
+        visited, position = board.get_state()
+        root_key = board.get_state_key()
+        inboxes[shard_of(root_key, num_workers)].put(
+            [("solve", root_key, visited, position, (-1, 0))]
+        )
+        _, mover_wins = results.get()
+
+        # 探索を止めて統計を集める
+        for inbox in inboxes:
+            inbox.put(None)
+        stats: dict[int, ShardStats] = {}
+        while len(stats) < num_workers:
+            worker_id, shard_stats = results.get()
+            stats[worker_id] = shard_stats
+    finally:
+        for worker in workers:
+            worker.join(timeout=1.0)
+            if worker.is_alive():
+                worker.terminate()
+    return mover_wins, [stats[i] for i in range(num_workers)]
+
+
+def _run_shard(
+    board: Board,
+    worker_id: int,
+    inboxes: list[Queue],
+    results: Queue,
+    l1_entries: int,
+):
+    """シャードを受け持つワーカーの処理
+
+    Args:
+        board (Board): チェスボード（状態はメッセージごとに設定し直す）
+        worker_id (int): ワーカー番号（受け持つシャードの番号）
+        inboxes (list[Queue]): 各ワーカーの受信キュー
+        results (Queue): ルートの結果と統計を返すキュー
+        l1_entries (int): 置換表の前に置くL1のスロット数（0なら置かない）
+    """
+    num_workers = len(inboxes)
+    inbox = inboxes[worker_id]
+    # 状態キー -> 手番が勝つか（L1はワーカーごとに持つ）
+    table: dict[int, bool] | TwoLevelTranspositionTable = {}
+    if l1_entries > 0:
+        table = TwoLevelTranspositionTable({}, l1_entries)
+    # 解いている途中の局面のキー -> [結果を待っている子局面の数, 返信先のリスト, まだ送っていない手, 盤面]
+    pending: dict[int, list] = {}
+    # 処理待ちのメッセージ（後に来たものから処理して、葉の結果を早く返す）
+    local: list[tuple] = []
+    outboxes: list[list[tuple]] = [[] for _ in range(num_workers)]
+    expanded = hits = local_messages = remote_messages = 0
+
+    def send(dest: int, message: tuple):
+        nonlocal local_messages, remote_messages
+        if dest == worker_id:
+            local.append(message)
+            local_messages += 1
+        else:
+            outboxes[dest].append(message)
+            remote_messages += 1
+
+    def reply(reply_to: tuple[int, int], mover_wins: bool):
+        dest, parent_key = reply_to
+        if dest < 0:
+            results.put((-1, mover_wins))
+        else:
+            send(dest, ("result", parent_key, mover_wins))
+
+    def resolve(key: int, mover_wins: bool):
+        table[key] = mover_wins
+        for reply_to in pending.pop(key)[1]:
+            reply(reply_to, mover_wins)
+
+    def solve(key: int, visited: int, position: int, reply_to: tuple[int, int]):
+        nonlocal expanded, hits
+        mover_wins = table.get(key)
+        if mover_wins is not None:
+            hits += 1
+            # 2段の表は値をfloatとして返すので、勝敗に戻して返信する
+            reply(reply_to, bool(mover_wins))
+            return
+        entry = pending.get(key)
+        if entry is not None:
+            hits += 1
+            entry[1].append(reply_to)
+            return
+
+        expanded += 1
+        board.set_state(visited, position)
+        moves = board.get_available_positions()
+        if not moves:
+            table[key] = False
+            reply(reply_to, False)
+            return
+        # 相手が動けなくなる手があれば、子局面を送らずに勝ちが決まる
+        moves_map = board.available_positions_map
+        for move in moves:
+            if not moves_map[move] & ~(visited | (1 << move)):
+                table[key] = True
+                reply(reply_to, True)
+                return
+
+        # 相手の動ける手が少ない手から調べ、最初の子局面で勝てなかった場合だけ残りを一度に送る
+        moves.sort(key=lambda move: (moves_map[move] & ~visited).bit_count())
+        pending[key] = [1, [reply_to], moves[1:], visited]
+        send_children(key, visited, moves[:1])
+
+    def send_children(key: int, visited: int, moves: list[int]):
+        for move in moves:
+            child_visited = visited | (1 << move)
+            board.set_state(child_visited, move)
+            child_key = board.get_state_key()
+            send(
+                shard_of(child_key, num_workers),
+                ("solve", child_key, child_visited, move, (worker_id, key)),
+            )
+
+    def receive(parent_key: int, child_mover_wins: bool):
+        entry = pending.get(parent_key)
+        if entry is None:
+            # 別の子局面で勝ちが確定した後の結果
+            return
+        if not child_mover_wins:
+            resolve(parent_key, True)
+            return
+        entry[0] -= 1
+        if entry[2]:
+            rest, entry[2] = entry[2], []
+            entry[0] += len(rest)
+            send_children(parent_key, entry[3], rest)
+        if entry[0] == 0:
+            resolve(parent_key, False)
+
+    while True:
+        # 自分の仕事がなければ他のワーカーからのメッセージを待つ
+        try:
+            batch = inbox.get(block=not local)
+        except queue.Empty:
+            batch = []
+        if batch is None:
+            break
+        local.extend(batch)
+
+        for _ in range(_MESSAGES_PER_FLUSH):
+            if not local:
+                break
+            message = local.pop()
+            if message[0] == "solve":
+                solve(*message[1:])
+            else:
+                receive(*message[1:])
+
+        for dest, outbox in enumerate(outboxes):
+            if outbox:
+                inboxes[dest].put(outbox)
+                outboxes[dest] = []
+
+    # 読まれないまま残ったメッセージの書き込みを待たずに終了できるようにする
+    for other_inbox in inboxes:
+        other_inbox.cancel_join_thread()
+    results.put(
+        (
+            worker_id,
+            ShardStats(
+                expanded,
+                len(table),
+                hits,
+                table.l1_hits if isinstance(table, TwoLevelTranspositionTable) else 0,
+                local_messages,
+                remote_messages,
+            ),
+        )
+    )
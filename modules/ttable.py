@@ -0,0 +1,654 @@
+"""置換表の実装
+
+勝敗だけを記録するコンパクトな置換表と、続けて行う探索の間で厳密な値を引き継ぐ世代付きの置換表、
+メモリに収まらない分をディスクへ書き出す置換表、それらの前に小さな表を置く2段の置換表を定義する。
+
+コンパクトな置換表：厳密な探索では置換表の値は先手の勝ち（1.0）か負け（0.0）だけなので、
+キーの30bitのフィンガープリントと2bitの値を1つの32bit整数に詰め、配列のバケットに格納する。
+Pythonの辞書では1エントリに90バイト程度かかるが、この表では4バイト（充填率を含めて5バイト程度）で済む。
+
+各キーは2つのバケット（1バケット4スロット）のいずれかに入る（partial-key cuckoo hashing）。
+もう一方のバケットはバケットの番号とフィンガープリントだけから求まるので、完全なキーなしでエントリを移せる。
+移し替えが一定回数で終わらなければ最後に追い出したエントリを捨てる（探索し直すだけで結果は変わらない）。
+
+フィンガープリントが一致すれば同じキーとみなすので、まれに別の局面の結果を使う（誤検出）。
+誤検出の回数の期待値は統計として表示し、大きい場合は完全なキーでの検証を有効にできる。
+"""
+
+import heapq
+import itertools
+import mmap
+import os
+import random
+import struct
+from array import array
+from collections.abc import Iterator
+
+# 1バケットのスロット数
+BUCKET_SLOTS = 4
+# フィンガープリントのビット数（残りの2bitに値を入れる）
+FINGERPRINT_BITS = 30
+# 移し替えの回数の上限
+_MAX_KICKS = 500
+
+_MASK64 = (1 << 64) - 1
+# ディスクの層の1エントリ（キーの上位64bit, キーの下位64bit, 先手の勝利確率）
+_RECORD = struct.Struct("<QQd")
+# 値の符号（0は空きスロット）
+_LOSS, _WIN = 1, 2
+
+
+def _mix_key(key: int) -> int:
+    """状態キーを64bitのハッシュ値にする
+
+    状態キーは64bitを超えることがあり、hash()では上位のbitがほとんど混ざらないため、
+    上位を64bitに畳み込んでからsplitmix64の混合関数を通す。
+    """
+    h = (key ^ ((key >> 64) * 0xFF51AFD7ED558CCD)) & _MASK64
+    h = ((h ^ (h >> 30)) * 0xBF58476D1CE4E5B9) & _MASK64
+    h = ((h ^ (h >> 27)) * 0x94D049BB133111EB) & _MASK64
+    return h ^ (h >> 31)
+
+
+class CompactTranspositionTable:
+    def __init__(self, megabytes: float, verify: bool = False):
+        """コンパクトな置換表を初期化する
+
+        Args:
+            megabytes (float): 表の大きさ（MB）。バケット数はこれに収まる最大の2のべき乗になる
+            verify (bool): 完全なキーも記録して誤検出を検証するかどうか（メモリは辞書と同程度になる）
+        """
+        num_buckets = 1
+        while num_buckets * 2 * BUCKET_SLOTS * 4 <= megabytes * (1 << 20):
+            num_buckets *= 2
+        self._bucket_mask = num_buckets - 1
+        self._slots = array("I", bytes(num_buckets * BUCKET_SLOTS * 4))
+        self._rng = random.Random(0)
+        self.verify = verify
+        self._keys: dict[int, float] = {}
+
+        self.entries = 0
+        self.lookups = 0
+        self.hits = 0
+        self.evictions = 0  # 移し替えが終わらず捨てたエントリの数
+        self.false_positives = 0  # 検証で見つかった誤検出の数（verifyのときだけ）
+
+    @property
+    def capacity(self) -> int:
+        """格納できるエントリ数の上限"""
+        return len(self._slots)
+
+    @property
+    def nbytes(self) -> int:
+        """表の配列のバイト数"""
+        return len(self._slots) * self._slots.itemsize
+
+    @property
+    def expected_false_positives(self) -> float:
+        """これまでの探索での誤検出の回数の期待値
+
+        1回の探索で比べるスロットは最大2バケット分で、それぞれが偶然一致する確率は2^-FINGERPRINT_BITSである。
+        """
+        occupancy = self.entries / self.capacity
+        return (
+            (self.lookups - self.hits)
+            * 2
+            * BUCKET_SLOTS
+            * occupancy
+            / (1 << FINGERPRINT_BITS)
+        )
+
+    def _locate(self, key: int) -> tuple[int, int]:
+        """キーのフィンガープリントと1つ目のバケットの番号を求める"""
+        h = _mix_key(key)
+        fingerprint = (h >> (64 - FINGERPRINT_BITS)) or 1
+        return fingerprint, h & self._bucket_mask
+
+    def _alternate(self, bucket: int, fingerprint: int) -> int:
+        """フィンガープリントとバケットの番号からもう一方のバケットの番号を求める"""
+        return bucket ^ ((fingerprint * 0x5BD1E995) & self._bucket_mask)
+
+    def get(self, key: int) -> float | None:
+        """キーの値を返す
+
+        Args:
+            key (int): 状態キー
+
+        Returns:
+            float | None: 先手の勝利確率（1.0か0.0）。なければNone
+        """
+        self.lookups += 1
+        fingerprint, bucket = self._locate(key)
+        slots = self._slots
+        for b in (bucket, self._alternate(bucket, fingerprint)):
+            base = b * BUCKET_SLOTS
+            for i in range(base, base + BUCKET_SLOTS):
+                entry = slots[i]
+                if entry >> 2 == fingerprint:
+                    value = 1.0 if entry & 3 == _WIN else 0.0
+                    if self.verify and self._keys.get(key) != value:
+                        # フィンガープリントだけが一致した別の局面
+                        self.false_positives += 1
+                        return None
+                    self.hits += 1
+                    return value
+        return None
+
+    def __setitem__(self, key: int, value: float):
+        """キーの値を記録する
+
+        Args:
+            key (int): 状態キー
+            value (float): 先手の勝利確率（1.0か0.0のみ）
+        """
+        if value == 1.0:
+            code = _WIN
+        elif value == 0.0:
+            code = _LOSS
+        else:
+            raise ValueError("コンパクトな置換表には勝敗（1.0か0.0）しか記録できません")
+        if self.verify:
+            self._keys[key] = value
+
+        fingerprint, bucket = self._locate(key)
+        entry = (fingerprint << 2) | code
+        slots = self._slots
+        alternate = self._alternate(bucket, fingerprint)
+        # 同じフィンガープリントがあれば上書きし、なければ空きスロットに入れる
+        empty = -1
+        for b in (bucket, alternate):
+            base = b * BUCKET_SLOTS
+            for i in range(base, base + BUCKET_SLOTS):
+                if slots[i] >> 2 == fingerprint:
+                    slots[i] = entry
+                    return
+                if empty < 0 and slots[i] == 0:
+                    empty = i
+        self.entries += 1
+        if empty >= 0:
+            slots[empty] = entry
+            return
+
+        # 空きがなければ、ランダムなスロットのエントリを追い出してそのもう一方のバケットへ移す
+        b = bucket
+        for _ in range(_MAX_KICKS):
+            i = b * BUCKET_SLOTS + self._rng.randrange(BUCKET_SLOTS)
+            entry, slots[i] = slots[i], entry
+            b = self._alternate(b, entry >> 2)
+            base = b * BUCKET_SLOTS
+            for i in range(base, base + BUCKET_SLOTS):
+                if slots[i] == 0:
+                    slots[i] = entry
+                    return
+        # 移し替えが終わらなかったので、最後に追い出したエントリを捨てる
+        self.entries -= 1
+        self.evictions += 1
+
+    def clear(self):
+        """表を空にする"""
+        self._slots = array("I", bytes(self.nbytes))
+        self._keys.clear()
+        self.entries = 0
+
+    def __len__(self) -> int:
+        return self.entries
+
+
+class GenerationalTranspositionTable:
+    def __init__(self, max_entries: int):
+        """世代付きの置換表を初期化する
+
+        1つのプロセスで探索を続けて行う場合に使う。探索ごとに世代を進め、
+        厳密な探索（葉を評価しない探索）で記録した値は次の探索でも使い、それ以外の値は記録した探索の中でだけ使う。
+        登録数がmax_entriesに達したら、古い世代の近似値、古い世代の厳密な値（古い世代から）、
+        現在の世代の近似値、現在の世代の厳密な値（それぞれ記録した順）の順に、登録数が4分の3になるまで捨てる。
+        エントリはタグ（世代と厳密な値かどうか）ごとの組に記録した順に並べて持つので、
+        捨てる際は表全体を調べずに、捨てるエントリの数とタグの種類の数に比例する手間で済む。
+
+        Args:
+            max_entries (int): 登録数の上限
+        """
+        self.max_entries = max_entries
+        # 状態キー -> (先手の勝利確率, 世代 << 1 | 厳密な値かどうか)
+        self._entries: dict[int, tuple[float, int]] = {}
+        # タグ（世代 << 1 | 厳密な値かどうか） -> そのタグのキー（記録した順）
+        self._buckets: dict[int, dict[int, None]] = {}
+        self.generation = 0
+        self.exact = True
+        # 状態キーの意味を決めるボードの設定（変わったら表を空にする）
+        self.signature: tuple | None = None
+
+        self.lookups = 0
+        self.hits = 0
+        self.carried_hits = 0  # 前の探索で記録した厳密な値を使えた回数
+        self.evictions = 0
+
+    def begin_search(self, signature: tuple, exact: bool):
+        """新しい探索を始める（世代を進める）
+
+        Args:
+            signature (tuple): ボードの設定（Board.get_key_signature）
+            exact (bool): 葉を評価しない厳密な探索かどうか
+        """
+        if signature != self.signature:
+            self.clear()
+            self.signature = signature
+        self.generation += 1
+        self.exact = exact
+
+    def get(self, key: int) -> float | None:
+        """キーの値を返す（古い世代の近似値は使わない）
+
+        Args:
+            key (int): 状態キー
+
+        Returns:
+            float | None: 先手の勝利確率（なければNone）
+        """
+        self.lookups += 1
+        entry = self._entries.get(key)
+        if entry is None:
+            return None
+        value, tag = entry
+        if tag >> 1 != self.generation:
+            if not tag & 1:
+                return None
+            # 使われた厳密な値は現在の世代に移して、追い出されにくくする
+            self._retag(key, tag, self.generation << 1 | 1)
+            self._entries[key] = (value, self.generation << 1 | 1)
+            self.carried_hits += 1
+        self.hits += 1
+        return value
+
+    def __setitem__(self, key: int, value: float):
+        """キーの値を現在の世代で記録する
+
+        Args:
+            key (int): 状態キー
+            value (float): 先手の勝利確率
+        """
+        tag = self.generation << 1 | int(self.exact)
+        entry = self._entries.get(key)
+        if entry is None:
+            if len(self._entries) >= self.max_entries:
+                self._evict()
+            self._buckets.setdefault(tag, {})[key] = None
+        elif entry[1] != tag:
+            self._retag(key, entry[1], tag)
+        self._entries[key] = (value, tag)
+
+    def _retag(self, key: int, old_tag: int, new_tag: int):
+        """キーをold_tagの組からnew_tagの組の末尾へ移す"""
+        bucket = self._buckets[old_tag]
+        del bucket[key]
+        if not bucket:
+            del self._buckets[old_tag]
+        self._buckets.setdefault(new_tag, {})[key] = None
+
+    def _evict(self):
+        """登録数が上限の4分の3になるまで、価値の低い値から捨てる"""
+        target = self.max_entries * 3 // 4
+        before = len(self._entries)
+        current = self.generation
+
+        def rank(tag: int) -> tuple[int, int]:
+            # 古い世代の近似値、古い世代の厳密な値（古い世代から）、現在の世代の近似値、現在の世代の厳密な値の順
+            generation, exact = tag >> 1, tag & 1
+            if generation != current:
+                return exact, generation
+            return 2 + exact, 0
+
+        for tag in sorted(self._buckets, key=rank):
+            excess = len(self._entries) - target
+            if excess <= 0:
+                break
+            bucket = self._buckets[tag]
+            if len(bucket) <= excess:
+                for key in bucket:
+                    del self._entries[key]
+                del self._buckets[tag]
+            else:
+                for key in list(itertools.islice(bucket, excess)):
+                    del bucket[key]
+                    del self._entries[key]
+        self.evictions += before - len(self._entries)
+
+    def clear(self):
+        """表を空にする"""
+        self._entries.clear()
+        self._buckets.clear()
+
+    def __len__(self) -> int:
+        return len(self._entries)
+
+
+class SpillingTranspositionTable:
+    def __init__(
+        self,
+        max_entries: int,
+        path: str,
+        max_runs: int = 8,
+        filter_bits_per_key: int = 10,
+    ):
+        """メモリに収まらない分をディスクへ書き出す置換表を初期化する
+
+        メモリの層は登録数がmax_entriesを超えると、古く記録した半分をキーの順に並べて
+        ディスクのファイルの末尾に追記する（ラン）。ディスクの層はランごとに二分探索で引き、
+        ランがmax_runs個を超えるか、フィルタの想定を超える数のエントリを書き出したら1つのランに併合する（コンパクション）。
+        ディスクの層のキーはBloomフィルタにも登録し、フィルタにないキーはディスクを読まずに不在と分かる。
+        ディスクの層から引いた値はメモリの層に戻す。値は任意の先手の勝利確率を記録できる。
+
+        Args:
+            max_entries (int): メモリの層の登録数の上限
+            path (str): ディスクの層のファイルパス（close()で削除する。コンパクションではpath + ".tmp"も使う）
+            max_runs (int): コンパクションを行うランの数
+            filter_bits_per_key (int): Bloomフィルタのディスクのエントリ1つあたりのビット数
+        """
+        if max_entries < 2:
+            raise ValueError("メモリの層の登録数の上限は2以上で指定してください")
+        # 別のファイルを上書きして削除しないように、既存のファイルは使わない
+        if os.path.exists(path + ".tmp"):
+            raise FileExistsError(f"{path}.tmpがすでに存在します")
+        self.max_entries = max_entries
+        self.path = path
+        self.max_runs = max_runs
+        self.filter_bits_per_key = filter_bits_per_key
+        self._memory: dict[int, float] = {}
+        self._file = open(path, "x+b")  # noqa: SIM115
+        self._map: mmap.mmap | None = None
+        # ディスクの層のラン（先頭のエントリの番号, エントリ数）。後のランほど新しい
+        self._runs: list[tuple[int, int]] = []
+        self.disk_records = 0
+        self._reset_filter(max_entries)
+
+        self.lookups = 0
+        self.memory_hits = 0
+        self.disk_hits = 0
+        self.filter_rejects = 0  # フィルタでディスクを読まずに済んだ回数
+        self.disk_misses = 0  # フィルタを通ったがディスクになかった回数（偽陽性）
+        self.spills = 0
+        self.compactions = 0
+
+    def _reset_filter(self, capacity: int):
+        """Bloomフィルタをcapacity個のキーを想定した大きさで空にする"""
+        self._filter_capacity = max(capacity, 1)
+        self._filter_bits = self._filter_capacity * self.filter_bits_per_key
+        self._filter = bytearray((self._filter_bits + 7) // 8)
+        # 偽陽性率を最小にするハッシュ関数の数（ln2 * ビット数/キー数）
+        self._filter_hashes = max(1, round(self.filter_bits_per_key * 0.693))
+
+    def _filter_positions(self, key: int) -> Iterator[int]:
+        """キーのBloomフィルタでのビットの位置を返す（ダブルハッシング）"""
+        h = _mix_key(key)
+        h1, h2 = h & 0xFFFFFFFF, (h >> 32) | 1
+        for i in range(self._filter_hashes):
+            yield (h1 + i * h2) % self._filter_bits
+
+    def _filter_add(self, key: int):
+        for bit in self._filter_positions(key):
+            self._filter[bit >> 3] |= 1 << (bit & 7)
+
+    def _filter_may_contain(self, key: int) -> bool:
+        return all(
+            self._filter[bit >> 3] >> (bit & 7) & 1
+            for bit in self._filter_positions(key)
+        )
+
+    def get(self, key: int) -> float | None:
+        """キーの値を返す
+
+        Args:
+            key (int): 状態キー
+
+        Returns:
+            float | None: 先手の勝利確率（なければNone）
+        """
+        self.lookups += 1
+        value = self._memory.get(key)
+        if value is not None:
+            self.memory_hits += 1
+            return value
+        if not self._runs:
+            return None
+        if not self._filter_may_contain(key):
+            self.filter_rejects += 1
+            return None
+        value = self._read_disk(key)
+        if value is None:
+            self.disk_misses += 1
+            return None
+        self.disk_hits += 1
+        self[key] = value
+        return value
+
+    def _read_disk(self, key: int) -> float | None:
+        """ディスクの層から新しいランの順に二分探索でキーを探す"""
+        assert self._map is not None
+        target = (key >> 64, key & _MASK64)
+        for start, count in reversed(self._runs):
+            lo, hi = start, start + count
+            while lo < hi:
+                mid = (lo + hi) // 2
+                high, low, value = _RECORD.unpack_from(self._map, mid * _RECORD.size)
+                if (high, low) < target:
+                    lo = mid + 1
+                elif (high, low) > target:
+                    hi = mid
+                else:
+                    return value
+        return None
+
+    def __setitem__(self, key: int, value: float):
+        """キーの値をメモリの層に記録する（あふれたら古い半分をディスクへ書き出す）
+
+        Args:
+            key (int): 状態キー
+            value (float): 先手の勝利確率
+        """
+        self._memory[key] = value
+        if len(self._memory) > self.max_entries:
+            self._spill()
+
+    def _spill(self):
+        """メモリの層の古い半分をキーの順に並べて、新しいランとしてディスクへ追記する"""
+        memory = self._memory
+        keys = []
+        for key in memory:
+            keys.append(key)
+            if len(keys) >= self.max_entries // 2:
+                break
+        keys.sort()
+        self._file.seek(self.disk_records * _RECORD.size)
+        self._file.write(
+            b"".join(
+                _RECORD.pack(key >> 64, key & _MASK64, memory.pop(key)) for key in keys
+            )
+        )
+        self._file.flush()
+        self._runs.append((self.disk_records, len(keys)))
+        self.disk_records += len(keys)
+        for key in keys:
+            self._filter_add(key)
+        self.spills += 1
+        if len(self._runs) > self.max_runs or self.disk_records > self._filter_capacity:
+            self._compact()
+        else:
+            self._remap()
+
+    def _remap(self):
+        """ファイルの大きさが変わった後に読み出し用のメモリマップを作り直す"""
+        if self._map is not None:
+            self._map.close()
+        self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+
+    def _iter_run(self, index: int) -> Iterator[tuple[int, int, int, float]]:
+        """ランのエントリをキーの順に (キー上位, キー下位, 新しさ, 値) で返す（新しいランほど新しさが小さい）"""
+        assert self._map is not None
+        start, count = self._runs[index]
+        for offset in range(
+            start * _RECORD.size, (start + count) * _RECORD.size, _RECORD.size
+        ):
+            high, low, value = _RECORD.unpack_from(self._map, offset)
+            yield high, low, -index, value
+
+    def _compact(self):
+        """すべてのランを1つのランに併合し、同じキーは新しい値だけを残してフィルタを作り直す
+
+        ランを先頭から順に読んで併合しながら別のファイルに書き、元のファイルと置き換えるので、
+        メモリはランの数に比例する分しか使わない。
+        """
+        self._remap()
+        tmp_path = self.path + ".tmp"
+        count = 0
+        last = None
+        # フィルタは併合後のエントリ数の2倍を想定した大きさにする（次のコンパクションまでの追記の分）
+        self._reset_filter(max(2 * self.disk_records, self.max_entries))
+        try:
+            with open(tmp_path, "wb") as out:
+                merged = heapq.merge(
+                    *(self._iter_run(i) for i in range(len(self._runs)))
+                )
+                for high, low, _, value in merged:
+                    if (high, low) == last:
+                        continue
+                    last = (high, low)
+                    out.write(_RECORD.pack(high, low, value))
+                    self._filter_add(high << 64 | low)
+                    count += 1
+        except BaseException:
+            # 書きかけのファイルを残さない（元のファイルはそのまま使える）
+            os.remove(tmp_path)
+            raise
+        assert self._map is not None
+        self._map.close()
+        self._map = None
+        self._file.close()
+        os.replace(tmp_path, self.path)
+        self._file = open(self.path, "r+b")  # noqa: SIM115
+        self._runs = [(0, count)] if count else []
+        self.disk_records = count
+        self.compactions += 1
+        if count:
+            self._remap()
+
+    @property
+    def memory_entries(self) -> int:
+        """メモリの層の登録数"""
+        return len(self._memory)
+
+    @property
+    def disk_bytes(self) -> int:
+        """ディスクの層のファイルのバイト数"""
+        return self.disk_records * _RECORD.size
+
+    def clear(self):
+        """表を空にする"""
+        self._memory.clear()
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+        self._file.truncate(0)
+        self._runs = []
+        self.disk_records = 0
+        self._reset_filter(self.max_entries)
+
+    def close(self):
+        """ディスクの層のファイルを閉じて削除する（コンパクションの書きかけのファイルが残っていれば削除する）"""
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+        self._file.close()
+        for path in (self.path, self.path + ".tmp"):
+            if os.path.exists(path):
+                os.remove(path)
+
+    def __len__(self) -> int:
+        # ディスクの層には同じキーが重複していることがあるので、併合するまでは多めに数える
+        return len(self._memory) + self.disk_records
+
+
+# 2段の置換表の下の段として使える置換表の型
+MainTable = (
+    dict[int, float]
+    | CompactTranspositionTable
+    | GenerationalTranspositionTable
+    | SpillingTranspositionTable
+)
+
+
+class TwoLevelTranspositionTable:
+    def __init__(self, main: MainTable, l1_entries: int):
+        """小さな直接写像の表（L1）を大きな置換表の前に置いた2段の置換表を初期化する
+
+        探索の参照は今の手順の近くで最近触れた局面に集中するので、まずL1を引き、なければ下の段を引いてL1に入れる。
+        L1はキーのハッシュで決まる1スロットだけを見るので、衝突したエントリは上書きする（下の段に残っている）。
+        記録はL1と下の段の両方に行う（ライトスルー）。
+
+        Args:
+            main (MainTable): 下の段の置換表
+            l1_entries (int): L1のスロット数（これ以下の最大の2のべき乗に切り下げる）
+        """
+        if l1_entries < 1:
+            raise ValueError("L1のスロット数は1以上で指定してください")
+        self.main = main
+        self._l1_bits = l1_entries.bit_length() - 1
+        self._l1_keys: list[int | None] = [None] * (1 << self._l1_bits)
+        self._l1_values = [0.0] * (1 << self._l1_bits)
+
+        self.lookups = 0
+        self.l1_hits = 0
+        self.main_hits = 0
+
+    @property
+    def l1_entries(self) -> int:
+        """L1のスロット数"""
+        return len(self._l1_keys)
+
+    def _slot(self, key: int) -> int:
+        """キーのL1でのスロットを求める（乗算ハッシュの上位ビット）"""
+        return ((hash(key) * 0x9E3779B97F4A7C15) & _MASK64) >> (64 - self._l1_bits)
+
+    def get(self, key: int) -> float | None:
+        """キーの値をL1、下の段の順に引く
+
+        Args:
+            key (int): 状態キー
+
+        Returns:
+            float | None: 先手の勝利確率（なければNone）
+        """
+        self.lookups += 1
+        slot = self._slot(key)
+        if self._l1_keys[slot] == key:
+            self.l1_hits += 1
+            return self._l1_values[slot]
+        value = self.main.get(key)
+        if value is not None:
+            self.main_hits += 1
+            self._l1_keys[slot] = key
+            self._l1_values[slot] = value
+        return value
+
+    def __setitem__(self, key: int, value: float):
+        """キーの値をL1と下の段に記録する
+
+        Args:
+            key (int): 状態キー
+            value (float): 先手の勝利確率
+        """
+        slot = self._slot(key)
+        self._l1_keys[slot] = key
+        self._l1_values[slot] = value
+        self.main[key] = value
+
+    def clear_l1(self):
+        """L1だけを空にする（下の段の値の有効性が変わるとき）"""
+        self._l1_keys = [None] * len(self._l1_keys)
+
+    def clear(self):
+        """表を空にする"""
+        self.clear_l1()
+        self.main.clear()
+
+    def __len__(self) -> int:
+        return len(self.main)
@@ -0,0 +1,181 @@
+"""移動順序のヒューリスティクスの重みの自動調整
+
+局面の集合に対して厳密な探索を行い、探索局面数の合計が最小になる重みを探す。
+結果は駒の種類・ボードサイズごとのプロファイルとしてJSONファイルに書き出し、探索時に読み込む。
+"""
+
+import argparse
+import json
+import random
+
+from .board import DEFAULT_ORDERING_WEIGHTS, Board
+from .minimax import clear_transposition_table, minimax
+
+# 重みの探索で1回に動かす量の候補
+_STEPS = [-4.0, -2.0, -1.0, -0.5, 0.5, 1.0, 2.0, 4.0]
+
+
+def load_ordering_weights(
+    path: str, piece_type: str, size: tuple[int, int]
+) -> dict[str, float]:
+    """プロファイルのファイルから駒の種類とボードサイズに合う重みを読み込む
+
+    ボードサイズごとの重みがなければ駒の種類の"default"を、それもなければ既定値を返す。
+
+    Args:
+        path (str): プロファイルのファイルパス
+        piece_type (str): 駒の種類
+        size (tuple[int, int]): ボードのサイズ（縦, 横）
+
+    Returns:
+        dict[str, float]: 特徴量ごとの重み
+    """
+    with open(path) as f:
+        profiles = json.load(f)
+    piece_profiles = profiles.get(piece_type, {})
+    weights = piece_profiles.get(
+        f"{size[0]}x{size[1]}", piece_profiles.get("default", {})
+    )
+    return DEFAULT_ORDERING_WEIGHTS | weights
+
+
+def create_corpus(size: tuple[int, int]) -> list[tuple[int, int]]:
+    """重みの評価に使う初期位置の集合を作る
+
+    対称な位置を除くため、盤面の左上の4分の1だけを使う。
+
+    Args:
+        size (tuple[int, int]): ボードのサイズ（縦, 横）
+
+    Returns:
+        list[tuple[int, int]]: 初期位置（縦, 横）のリスト
+    """
+    return [
+        (row, col)
+        for row in range((size[0] + 1) // 2)
+        for col in range((size[1] + 1) // 2)
+        if size[0] != size[1] or col <= row
+    ]
+
+
+def count_corpus_nodes(
+    piece_type: str,
+    size: tuple[int, int],
+    corpus: list[tuple[int, int]],
+    weights: dict[str, float],
+    node_limit: int | None = None,
+) -> int:
+    """与えられた重みで局面の集合を厳密に探索し、探索局面数の合計を返す
+
+    Args:
+        piece_type (str): 駒の種類
+        size (tuple[int, int]): ボードのサイズ（縦, 横）
+        corpus (list[tuple[int, int]]): 初期位置のリスト
+        weights (dict[str, float]): 特徴量ごとの重み
+        node_limit (int | None): 合計がこれを超えたら打ち切る（打ち切った時点の合計を返す）
+
+    Returns:
+        int: 探索局面数の合計
+    """
+    total = 0
+    for initial_position in corpus:
+        board = Board(size, initial_position, piece_type, 0, ordering_weights=weights)
+        clear_transposition_table()
+        _, node_count = minimax(board, 0, True, False, True, board.len + 1, 0.0, 1.0)
+        total += node_count
+        if node_limit is not None and total > node_limit:
+            break
+    clear_transposition_table()
+    return total
+
+
+def tune_ordering_weights(
+    piece_type: str,
+    size: tuple[int, int],
+    iterations: int,
+    seed: int | None,
+    initial_weights: dict[str, float] | None = None,
+    verbose: bool = False,
+) -> tuple[dict[str, float], int, int]:
+    """局所探索で探索局面数の合計が最小になる重みを探す
+
+    ランダムに選んだ特徴量の重みを少しずつ動かし、局面数が減った場合だけ採用する。
+
+    Args:
+        piece_type (str): 駒の種類
+        size (tuple[int, int]): ボードのサイズ（縦, 横）
+        iterations (int): 重みを動かす試行回数
+        seed (int | None): 乱数シード
+        initial_weights (dict[str, float] | None): 初期の重み（Noneなら既定値）
+        verbose (bool): 途中経過を表示するかどうか
+
+    Returns:
+        tuple[dict[str, float], int, int]: (最良の重み, その局面数の合計, 既定値での局面数の合計)
+    """
+    rng = random.Random(seed)
+    corpus = create_corpus(size)
+    best = DEFAULT_ORDERING_WEIGHTS | (initial_weights or {})
+    baseline = count_corpus_nodes(piece_type, size, corpus, DEFAULT_ORDERING_WEIGHTS)
+    best_nodes = count_corpus_nodes(piece_type, size, corpus, best)
+
+    features = list(DEFAULT_ORDERING_WEIGHTS)
+    for i in range(iterations):
+        candidate = dict(best)
+        feature = rng.choice(features)
+        candidate[feature] += rng.choice(_STEPS)
+        # 現在の最良より悪くなった時点で打ち切る
+        nodes = count_corpus_nodes(piece_type, size, corpus, candidate, best_nodes)
+        if nodes < best_nodes:
+            best, best_nodes = candidate, nodes
+        if verbose:
+            print(
+                f"  [{i + 1}/{iterations}] {candidate} -> {nodes:,} "
+                f"(最良 {best_nodes:,})"
+            )
+    return best, best_nodes, baseline
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="移動順序の重みの自動調整")
+    parser.add_argument("output", type=str, help="プロファイルの出力先のファイルパス")
+    parser.add_argument(
+        "--pieces",
+        type=str,
+        nargs="+",
+        default=["rook", "king", "queen", "knight"],
+        help="調整する駒の種類",
+    )
+    parser.add_argument(
+        "--sizes",
+        type=str,
+        nargs="+",
+        default=["4x4", "4x5"],
+        help="調整するボードサイズ（縦x横）。最後のサイズの重みを駒の既定値にする",
+    )
+    parser.add_argument("--iterations", type=int, default=30, help="試行回数")
+    parser.add_argument("--seed", type=int, default=0, help="乱数シード")
+    parser.add_argument("--verbose", action="store_true", help="途中経過を表示する")
+    args = parser.parse_args()
+
+    profiles: dict[str, dict[str, dict[str, float]]] = {}
+    for piece_type in args.pieces:
+        profiles[piece_type] = {}
+        weights = None
+        for size_str in args.sizes:
+            height, width = map(int, size_str.split("x"))
+            # 前のサイズの結果から探索を始める
+            weights, nodes, baseline = tune_ordering_weights(
+                piece_type,
+                (height, width),
+                args.iterations,
+                args.seed,
+                weights,
+                args.verbose,
+            )
+            profiles[piece_type][size_str] = weights
+            print(f"{piece_type} {size_str}: {baseline:,} -> {nodes:,} {weights}")
+        if weights is not None:
+            profiles[piece_type]["default"] = weights
+
+    with open(args.output, "w") as f:
+        json.dump(profiles, f, indent=2)